@@ -6,6 +6,7 @@ var Uglify = require('uglify-js'),
 	jsgen = require('./jsgen');
 
 module.exports = IR;
+IR.ConstantPool = ConstantPool;
 
 const API_VERSION = '1';
 
@@ -132,7 +133,12 @@ IR.prototype.parseNode = function(state, node) {
 		}));
 		handled = true; // don't descend
 	} else if (node instanceof Uglify.AST_Defun) {
-		var expr = self.createJSExpression('var '+node.name.name+'=('+node.print_to_string()+');'+node.name.name,node);
+		var printed = printWithLines(node),
+			prefix = 'var '+node.name.name+'=(',
+			lines = printed.lines.map(function(mark){
+				return [mark[0]+prefix.length, mark[1]];
+			}),
+			expr = self.createJSExpression(prefix+printed.code+');'+node.name.name,node,lines);
 		expr.name = node.name.name;
 		handled = true;
 	} else if (node instanceof Uglify.AST_For || node instanceof Uglify.AST_Do || node instanceof Uglify.AST_ForIn || node instanceof Uglify.AST_Try) {
@@ -215,15 +221,36 @@ IR.prototype.isIgnoreNode = function(node) {
 };
 
 /**
- * turn the IR into native JSC code
+ * turn the IR into native JSC code. the JS code nodes are compiled together
+ * into functions with one evaluation up front and then called in turn, so
+ * JSC parses the module's JS once instead of once per code node. string and
+ * number literals come from constants, a ConstantPool shared by the
+ * translation unit, when one is given
  */
-IR.prototype.toNative = function(indent) {
-	var code = [];
+IR.prototype.toNative = function(indent, constants) {
+	var code = [],
+		fragments = this.filter(function(node){
+			return node.type==='code';
+		});
+	if (fragments.length) {
+		this.fragments = makeVariableName();
+		fragments.forEach(function(node,index){
+			node.fragment = index;
+		});
+		splitCodeIntoLines(code, compileFragments(this, fragments, indent));
+	}
+	this.constants = constants || null;
+	constants && (constants.referenced = false);
 	this.iterate(function(node){
 		node.toNative(indent).split('\n').forEach(function(line){
 			code.push(line);
 		});
 	});
+	if (constants && constants.referenced) {
+		code.unshift(codeToString([constants.initializer+'(ctx);'], indent));
+	}
+	this.fragments = null;
+	this.constants = null;
 	return code;
 };
 
@@ -238,8 +265,12 @@ IR.prototype.coalesce = function() {
 		// we see the the previous node is code and this node is also 
 		// code, so we coalesce the nodes together so we can have fewer evals
 		if (prev && node.type==='code' && prev.type==='code') {
-			var as = !/;$/.test(prev.code) ? ';' : '';
+			var as = !/;$/.test(prev.code) ? ';' : '',
+				offset = prev.code.length + as.length;
 			prev.code += as + node.code;
+			prev.lines = prev.lines.concat(node.lines.map(function(mark){
+				return [mark[0]+offset, mark[1]];
+			}));
 		}
 		else {
 			newnodes.push(node);
@@ -292,16 +323,16 @@ IR.prototype.addConst = function(name, value, is_static, node) {
 };
 
 IR.prototype.addJSExpression = function(node) {
-	var code = node.print_to_string();
-	var expr = new Code(this, code, node);
+	var printed = printWithLines(node);
+	var expr = new Code(this, printed.code, node, printed.lines);
 	this.pushToNode(expr, node);
 };
 
-IR.prototype.createJSExpression = function(code, node){
+IR.prototype.createJSExpression = function(code, node, lines){
 	// this will actually turn JS code into an expression node (new node) from a different node
 	var n = Uglify.parse(code);
 	n.start = node.start;
-	var expr = new Code(this, code, n);
+	var expr = new Code(this, code, n, lines);
 	this.pushToNode(expr, n);
 	return expr;
 };
@@ -399,15 +430,17 @@ Variable.prototype.toNative = function(indent) {
 	code.push('// variable:'+this.line+' '+(this.is_const?'(const)':''));
 	if (this.is_static) {
 		// value is set as static value
-		makeJSValue(this.value,this.metatype,'auto '+this.name+' = ',code);
+		makeJSValue(this.ir,this.value,this.metatype,'auto '+this.name+' = ',code);
 		code.push('auto '+v+' = JSStringCreateWithUTF8CString("'+this.name+'");');
 		code.push('JSObjectSetProperty(ctx,object,'+v+','+this.name+','+p+',exception);');
+		code.push('JSStringRelease('+v+');');
 	}
 	else {
 		// value is set from another variable value
 		var s = makeVariableName();
 		code.push('auto '+s+' = JSStringCreateWithUTF8CString("'+this.value+'");');
 		code.push('auto '+this.name+' = JSObjectGetProperty(ctx,object,'+s+',exception);');
+		code.push('JSStringRelease('+s+');');
 		code.push('auto '+v+' = JSStringCreateWithUTF8CString("'+this.name+'");');
 		code.push('JSObjectSetProperty(ctx,object,'+v+','+this.name+','+p+',exception);');
 		code.push('JSStringRelease('+v+');');
@@ -449,7 +482,7 @@ Argument.prototype.toNative = function(indent, varname) {
 	var varassign = makeVarAssign(this.ir,varname);
 	switch (this.metatype) {
 		case 'value': {
-			makeJSValue(this.value,this.type,varassign,code);
+			makeJSValue(this.ir,this.value,this.type,varassign,code);
 			break;
 		}
 		case 'variable': {
@@ -513,10 +546,12 @@ Expression.prototype.toNative = function(indent, varname) {
 
 //---------------------------------------------------------------------------//
 
-function Code(ir, code, node) {
+function Code(ir, code, node, lines) {
 	this.ir = ir;
 	this.type = 'code';
 	this.code = code;
+	// [column, line] of the tokens of code on their original source lines
+	this.lines = lines || [];
 
 	if (node) {
 		annotateExpr(ir, this, node);
@@ -554,6 +589,15 @@ Code.prototype.toNative = function(indent, varname) {
 	var code = [];
 	code.push('// sourcecode:'+this.line);
 
+	if (this.ir.fragments) {
+		// compiled by IR.toNative
+		code.push('// '+JSON.stringify(this.code));
+		code.push(makeVarAssign(this.ir,varname||this.name)+'JSObjectCallAsFunction(ctx,'+this.ir.fragments+'['+this.fragment+'],object,0,nullptr,exception);');
+		code.push('CHECK_EXCEPTION(exception);');
+		code.push('');
+		return codeToString(code, indent);
+	}
+
 	//TODO: use the symbol table for sourcecode
 	
 	var varassign = makeVarAssign(this.ir,varname||this.name),
@@ -580,6 +624,247 @@ Code.prototype.toNative = function(indent, varname) {
 	return codeToString(code, indent);
 };
 
+/**
+ * return the code of node printed on one line and the [column, line] of its
+ * tokens in the original source
+ */
+function printWithLines(node) {
+	var lines = [],
+		code = node.print_to_string({source_map:{add:function(source, line, col, origLine, origCol){
+			origLine && lines.push([col, origLine]);
+		}}});
+	return {code:code, lines:lines};
+}
+
+/**
+ * return the original line of column col of code printed by printWithLines,
+ * or line when none of its tokens come before it
+ */
+function lineAt(lines, col, line) {
+	for (var c=0;c<lines.length && lines[c][0]<=col;c++) {
+		line = lines[c][1];
+	}
+	return line;
+}
+
+/**
+ * return src as the source of a function that runs it the way evaluating it
+ * at global scope would. its declarations become assignments and their names
+ * are added to names so they can be declared globally, and the value of a
+ * final expression statement is returned. the function is printed one
+ * statement per line and lines[i] is the original line of line i, from
+ * lineOf of the column in src of its first token
+ */
+function hoistFragment(src, names, lineOf) {
+	var ast = Uglify.parse(src),
+		functions = [],
+		directives = 0,
+		transformer;
+
+	function assign(name, value) {
+		return new Uglify.AST_Assign({
+			operator: '=',
+			left: new Uglify.AST_SymbolRef({name:name}),
+			right: value
+		});
+	}
+
+	transformer = new Uglify.TreeTransformer(function(node){
+		if (node instanceof Uglify.AST_Defun) {
+			// function declarations are hoisted, so they are assigned first
+			names[node.name.name] = 1;
+			functions.push(new Uglify.AST_SimpleStatement({
+				body: assign(node.name.name, new Uglify.AST_Function({
+					name: new Uglify.AST_SymbolLambda({name:node.name.name}),
+					argnames: node.argnames,
+					body: node.body
+				}))
+			}));
+			return new Uglify.AST_EmptyStatement();
+		}
+		if (node instanceof Uglify.AST_Lambda) {
+			// their declarations are their own
+			return node;
+		}
+		if (node instanceof Uglify.AST_Definitions) {
+			var parent = transformer.parent(),
+				assignments = [];
+			node.definitions.forEach(function(def){
+				names[def.name.name] = 1;
+				def.value && assignments.push(assign(def.name.name, def.value));
+			});
+			if (parent instanceof Uglify.AST_ForIn && parent.init===node) {
+				return new Uglify.AST_SymbolRef({name:node.definitions[0].name.name});
+			}
+			var expression = assignments.length ? Uglify.AST_Seq.from_array(assignments) : null;
+			if (parent instanceof Uglify.AST_For && parent.init===node) {
+				return expression;
+			}
+			return expression ? new Uglify.AST_SimpleStatement({body:expression}) : new Uglify.AST_EmptyStatement();
+		}
+	});
+
+	ast = ast.transform(transformer);
+
+	while (directives < ast.body.length && ast.body[directives] instanceof Uglify.AST_Directive) {
+		directives++;
+	}
+	var body = ast.body.slice(0,directives).concat(functions, ast.body.slice(directives)),
+		last = body[body.length-1];
+	if (last instanceof Uglify.AST_SimpleStatement) {
+		body[body.length-1] = new Uglify.AST_Return({value:last.body});
+	}
+
+	var lines = [],
+		code = new Uglify.AST_Function({argnames:[], body:body}).print_to_string({beautify:true, source_map:{add:function(source, line, col, origLine, origCol){
+			lines[line-1] = lines[line-1] || lineOf(origCol);
+		}}});
+	return {code:code, lines:lines};
+}
+
+/**
+ * return the code that evaluates the code nodes of ir as an array of
+ * functions and keeps them in ir.fragments. each line of a function is padded
+ * down to the original line of its first token, and lines that can't be are
+ * joined to the one before, so errors report the original lines
+ */
+function compileFragments(ir, fragments, indent) {
+	var code = [],
+		names = {},
+		program = '',
+		line = 1,
+		s = makeVariableName(),
+		v = makeVariableName(),
+		f = makeVariableName(),
+		r = makeVariableName(),
+		a = makeVariableName();
+
+	fragments.forEach(function(node,index){
+		var fn = hoistFragment(node.code.replace(/;,/g,';'), names, function(col){ //FIXME: see Code.toNative
+			return lineAt(node.lines, col, node.line);
+		});
+		program += index ? ',' : '';
+		fn.code.split('\n').forEach(function(text,c){
+			if (fn.lines[c] > line) {
+				for (; line < fn.lines[c]; line++) {
+					program += '\n';
+				}
+				program += text;
+			}
+			else {
+				// statements end in ; so joining lines is safe
+				program += (c ? ' ' : '') + text.trim();
+			}
+		});
+	});
+
+	var declarations = Object.keys(names);
+	program = (declarations.length ? 'var '+declarations.join(',')+';' : '') + '[' + program + ']';
+
+	code.push('// '+fragments.length+' code fragments compiled as functions');
+	code.push('// '+JSON.stringify(program));
+	code.push('const char '+s+'[] = { '+bufferToCIntArray(new Buffer(program, 'utf8'))+' };');
+	code.push('auto '+v+' = JSStringCreateWithUTF8CString('+s+');');
+	code.push('auto '+f+' = JSStringCreateWithUTF8CString("'+ir.filename+'");');
+	code.push('auto '+r+' = JSEvaluateScript(ctx,'+v+',object,'+f+',1,exception);');
+	code.push('JSStringRelease('+v+');');
+	code.push('JSStringRelease('+f+');');
+	code.push('CHECK_EXCEPTION(exception);');
+	code.push('auto '+a+' = JSValueToObject(ctx,'+r+',exception);');
+	code.push('CHECK_EXCEPTION(exception);');
+	code.push('JSObjectRef '+ir.fragments+'['+fragments.length+'];');
+	code.push('for (unsigned i = 0; i < '+fragments.length+'; i++)');
+	code.push('{');
+	code.push('\t'+ir.fragments+'[i] = JSValueToObject(ctx,JSObjectGetPropertyAtIndex(ctx,'+a+',i,exception),exception);');
+	code.push('\tCHECK_EXCEPTION(exception);');
+	code.push('}');
+	code.push('');
+	return codeToString(code, indent);
+}
+
+//---------------------------------------------------------------------------//
+
+/**
+ * the string and number literals of the IR in a translation unit. each
+ * distinct literal is made into a JSValueRef once, when the first module
+ * using them loads, and stays protected for the life of the process
+ */
+function ConstantPool(name) {
+	this.name = name;
+	this.initializer = name+'_Initialize';
+	this.values = [];
+	this.indexes = {};
+	this.referenced = false;
+}
+
+Object.defineProperty(ConstantPool.prototype, "size", {
+	get: function size() {
+		return this.values.length;
+	}
+});
+
+/**
+ * return true for the types kept in the pool
+ */
+ConstantPool.prototype.has = function(type) {
+	return type==='string' || type==='number';
+};
+
+/**
+ * return the expression for the pooled literal, adding it when it is new
+ */
+ConstantPool.prototype.reference = function(value, type) {
+	var key = type+':'+value,
+		index = this.indexes[key];
+	if (index===undefined) {
+		index = this.indexes[key] = this.values.length;
+		this.values.push({value:value, type:type});
+	}
+	this.referenced = true;
+	return this.name+'['+index+']';
+};
+
+/**
+ * return the pool and the function that fills it
+ */
+ConstantPool.prototype.toNative = function() {
+	var self = this,
+		code = [];
+	code.push('static JSValueRef '+this.name+'['+this.values.length+'];');
+	code.push('');
+	code.push('static void '+this.initializer+'(JSContextRef ctx)');
+	code.push('{');
+	code.push('\tstatic bool initialized = false;');
+	code.push('\tif (initialized)');
+	code.push('\t{');
+	code.push('\t\treturn;');
+	code.push('\t}');
+	this.values.forEach(function(constant,index){
+		var entry = self.name+'['+index+']',
+			lines = [];
+		if (constant.type==='string') {
+			var v = makeVariableName(),
+				s = makeVariableName();
+			lines.push('// '+JSON.stringify(constant.value));
+			lines.push('const char '+s+'[] = { '+bufferToCIntArray(new Buffer(constant.value, 'utf8'))+' };');
+			lines.push('auto '+v+' = JSStringCreateWithUTF8CString('+s+');');
+			lines.push(entry+' = JSValueMakeString(ctx,'+v+');');
+			lines.push('JSStringRelease('+v+');');
+		}
+		else {
+			lines.push(entry+' = JSValueMakeNumber(ctx,'+constant.value+');');
+		}
+		lines.push('JSValueProtect(ctx,'+entry+');');
+		code.push('\t{');
+		splitCodeIntoLines(code, codeToString(lines, '\t\t'));
+		code.push('\t}');
+	});
+	code.push('\tinitialized = true;');
+	code.push('}');
+	code.push('');
+	return code.join('\n');
+};
+
 //---------------------------------------------------------------------------//
 function getLineFromNode(node) {
 	return (node && node.start && node.start.line) || 0;
@@ -590,7 +875,11 @@ function annotateExpr(self, expr, node) {
 	expr.line = expr.line || getLineFromNode(node);
 }
 
-function makeJSValue(value, type, varassign, code) {
+function makeJSValue(ir, value, type, varassign, code) {
+	if (ir.constants && ir.constants.has(type)) {
+		code.push(varassign+ir.constants.reference(value,type)+'; // '+JSON.stringify(value));
+		return;
+	}
 	switch (type) {
 		case 'number': {
 			code.push(varassign+'JSValueMakeNumber(ctx,'+value+');');
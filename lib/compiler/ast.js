@@ -711,6 +711,13 @@ function compile (options, state, library, arch, source, filename, jsfilename, b
 		}
 		else if (node instanceof Uglify.AST_Call) {
 
+			// typed array views over native memory are builtins called by name
+			if (node.expression instanceof Uglify.AST_SymbolRef && /^Hyperloop_Memory_(View_(float|double|int|uint|short|ushort|char|uchar)|Pointer)$/.test(node.expression.name)) {
+				state.builtin_symbols = state.builtin_symbols || {};
+				state.builtin_symbols[node.expression.name] = node.expression.name;
+				return;
+			}
+
 			// deal with special Hyperloop commands
 			if (node.start.value === 'Hyperloop') {
 				var dict = {},
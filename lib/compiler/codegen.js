@@ -3,13 +3,20 @@
  */
 var fs = require('fs'),
 	path = require('path'),
+	Uglify = require('uglify-js'),
 	wrench = require('wrench'),
 	log = require('../log'),
 	util = require('../util'),
 	jsgen = require('./jsgen'),
+	IR = require('./IR'),
+	sourcepack = require('./sourcepack'),
 	syslibrary = require('./library');
 
 exports.generateLibrary = generateLibrary;
+exports.resolveRequire = resolveRequire;
+exports.generateRequireTable = generateRequireTable;
+exports.findRequires = findRequires;
+exports.generateRequire = generateRequire;
 
 function generateLibrary (options, build_opts, arch, state, library, uncompiledFiles, compiledFiles, callback) {
 	// we are going to load the platform library from the platform dir
@@ -98,20 +105,18 @@ function generateLibrary (options, build_opts, arch, state, library, uncompiledF
 	platform_lib.compileLibrary(options, arch, state.metabase, callback);
 }
 
-function generateDecode(jscodevar, indent, code, varname) {
-	var buf = jsgen.makeVariableName(),
-		result = jsgen.makeVariableName();
-	code.push(indent+'char '+buf+'['+jscodevar+'_length+1];');
-	code.push(indent+'memset('+buf+',0,'+jscodevar+'_length);');
-	code.push(indent+buf+'['+jscodevar+'_length]=\'\\0\';');
-	code.push(indent+'HL_DECODE_'+jscodevar+'('+jscodevar+','+buf+');');
-	code.push(indent+'std::string '+result+' = base64_decode(std::string('+buf+'));');
-	code.push(indent+'auto '+varname+' = JSStringCreateWithUTF8CString('+result+'.c_str());');
-	code.push(indent+'memset('+buf+',0,'+jscodevar+'_length);');
-	return result;
+function generateDecode(jscodevar, indent, code, varname, characters) {
+	if (characters) {
+		// already the UTF-16 JavaScriptCore takes, nothing to decode or prefetch
+		code.push(indent+'auto '+varname+' = HyperloopCreateEmbedString('+jscodevar+','+jscodevar+'_length);');
+		return;
+	}
+	// streams the obfuscated source through XOR, base64 or LZ4 and UTF-8 -> UTF-16 in one
+	// pass, unless a prefetch thread already did
+	code.push(indent+'auto '+varname+' = HyperloopTakeEmbedString('+jscodevar+','+jscodevar+'_length,_HL_XOR);');
 }
 
-function generateRequire(state,indent, ir, id, filename, dirname, symbols, symbolnames, cleanup, jscode, code, jscodevar, moduleid) {
+function generateRequire(state,indent, ir, id, filename, dirname, symbols, symbolnames, cleanup, jscode, code, jscodevar, moduleid, debugsource, wrap, characters, constants) {
 	code.push(indent+'static JSValueRef result = nullptr;');
 	code.push(indent+'if (result==nullptr)');
 	code.push(indent+'{');
@@ -125,8 +130,9 @@ function generateRequire(state,indent, ir, id, filename, dirname, symbols, symbo
 	code.push('');
 
 	// properties that we are going to save and then restore in the global scope each
-	// time we load a module
-	var modulePropertyNames = ['module','exports','__filename','__dirname','require'],
+	// time we load a module. a module evaluated in a function wrapper gets them as
+	// arguments instead and leaves the global object alone
+	var modulePropertyNames = wrap ? [] : ['module','exports','__filename','__dirname','require'],
 		moduleVariables = {};
 
 	// save off our global module variables that we will later re-link after the module is loaded
@@ -134,7 +140,7 @@ function generateRequire(state,indent, ir, id, filename, dirname, symbols, symbo
 		var n = jsgen.makeVariableName(),
 			v = jsgen.makeVariableName();
 		code.push(indent+'// '+name);
-		code.push(indent+'auto '+n+' = JSStringCreateWithUTF8CString("'+name+'");');
+		code.push(indent+'auto '+n+' = HyperloopWellKnownString(kHyperloopString_'+name+');');
 		code.push(indent+'auto '+v+' = JSObjectGetProperty(ctx,object,'+n+',exception);');
 		moduleVariables[name]=[n,v];
 	});
@@ -144,7 +150,7 @@ function generateRequire(state,indent, ir, id, filename, dirname, symbols, symbo
 	code.push(indent+'auto module = HyperloopCreateModule(ctx,parent,"'+filename+'","'+dirname+'",exception);');
 	code.push('');
 
-	code.push(indent+'// set properties into our global scope from the module');
+	modulePropertyNames.length && code.push(indent+'// set properties into our global scope from the module');
 	modulePropertyNames.forEach(function(name){
 		var vars = moduleVariables[name];
 		if (name!=='module') {
@@ -157,15 +163,7 @@ function generateRequire(state,indent, ir, id, filename, dirname, symbols, symbo
 	code.push('');
 
 	// process builtin symbols such as memory operations
-	if (state.builtin_symbols) {
-		code.push(indent+'// process builtin symbols');
-		Object.keys(state.builtin_symbols).forEach(function(key) {
-			code.push(indent+'auto '+key+'Property = JSStringCreateWithUTF8CString("'+key+'");');
-			code.push(indent+'auto '+key+'Fn = JSObjectMakeFunctionWithCallback(ctx,'+key+'Property,'+key+');');
-			code.push(indent+'JSObjectSetProperty(ctx,object,'+key+'Property,'+key+'Fn,kJSPropertyAttributeReadOnly|kJSPropertyAttributeDontEnum|kJSPropertyAttributeDontDelete,nullptr);');
-			code.push('');
-		});
-	}
+	generateBuiltinSymbols(state,indent,code);
 
 	if (symbols && symbols.length) {
 		code.push(indent+'// process our symbols in scope');
@@ -178,7 +176,7 @@ function generateRequire(state,indent, ir, id, filename, dirname, symbols, symbo
 	if (ir) {
 		code.push(indent+'// ---- IR code generation ----');
 		code.push('');
-		ir.toNative().forEach(function(line){
+		ir.toNative(null,constants).forEach(function(line){
 			code.push(indent+line);
 		});
 	}
@@ -187,11 +185,17 @@ function generateRequire(state,indent, ir, id, filename, dirname, symbols, symbo
 		code.push('');
 		var v = jsgen.makeVariableName(),
 			n = jsgen.makeVariableName();
-		generateDecode(jscodevar,indent,code,n);
+		generateDecode(jscodevar,indent,code,n,characters);
 		code.push('');
 		code.push(indent+'auto '+v+' = JSStringCreateWithUTF8CString("'+filename+'");');
-		code.push(indent+'JSEvaluateScript(ctx,'+n+',nullptr,'+v+',1,exception);');
+		if (wrap) {
+			code.push(indent+'HyperloopEvaluateModule(ctx,module,'+n+','+v+',exception);');
+		}
+		else {
+			code.push(indent+'JSEvaluateScript(ctx,'+n+',nullptr,'+v+',1,exception);');
+		}
 		code.push(indent+'JSStringRelease('+v+');');
+		code.push(indent+'JSStringRelease('+n+');');
 		code.push(indent+'CHECK_EXCEPTION(exception);');
 	}
 
@@ -200,11 +204,10 @@ function generateRequire(state,indent, ir, id, filename, dirname, symbols, symbo
 	code.push(indent+'result = HyperloopModuleLoaded(ctx,module);');
 
 	code.push('');	
-	code.push(indent+'// restore previous module values back into global');	
+	modulePropertyNames.length && code.push(indent+'// restore previous module values back into global');	
 	modulePropertyNames.forEach(function(name){
 		var vars = moduleVariables[name];
 		code.push(indent+'JSObjectSetProperty(ctx,object,'+vars[0]+','+vars[1]+',0,exception);');
-		code.push(indent+'JSStringRelease('+vars[0]+');');
 	});
 
 	code.push('');
@@ -236,6 +239,21 @@ function generateRequire(state,indent, ir, id, filename, dirname, symbols, symbo
 	return jscode;
 }
 
+/**
+ * set the builtin symbols such as memory operations into the global object
+ */
+function generateBuiltinSymbols(state, indent, code) {
+	if (state.builtin_symbols) {
+		code.push(indent+'// process builtin symbols');
+		Object.keys(state.builtin_symbols).forEach(function(key) {
+			code.push(indent+'auto '+key+'Property = HyperloopInternString("'+key+'");');
+			code.push(indent+'auto '+key+'Fn = JSObjectMakeFunctionWithCallback(ctx,'+key+'Property,'+key+');');
+			code.push(indent+'JSObjectSetProperty(ctx,object,'+key+'Property,'+key+'Fn,kJSPropertyAttributeReadOnly|kJSPropertyAttributeDontEnum|kJSPropertyAttributeDontDelete,nullptr);');
+			code.push('');
+		});
+	}
+}
+
 function generateVarname (name) {
 	var x = '0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ$_',
 		buf = '_',
@@ -303,9 +321,25 @@ function generateSourceEmbed (library, options, state, platform_lib, filemap, ex
 
 	var ecode = [],
 		defines = [],
-		decoders = [],
 		mapping = [],
-		varnames = [];
+		varnames = [],
+		format = options['embed-format'],
+		// UTF-16 sources are embedded as is for builds that don't need them hidden
+		characters = format==='utf16',
+		// otherwise they are base64 encoded, or LZ4 compressed with 'embed-format' lz4
+		embed = characters ?
+			function(source, debugfn) { return jsgen.characters(source,null,debugfn); } :
+			format==='lz4' ?
+			function(source, debugfn) { return jsgen.compress(source,null,debugfn); } :
+			function(source, debugfn) { return jsgen.transform(source,null,null,debugfn); },
+		type = characters ? 'JSChar' : 'char',
+		// the literals of every IR module in this unit
+		constants = new IR.ConstantPool('HyperloopConstants_'+moduleid),
+		// with a source pack, sources that need no native code are written to a
+		// file the runtime maps instead of being compiled into this unit
+		pack = options['source-pack'] ? {} : null,
+		packName = name+'.hlpack',
+		key = parseInt(options.xor || jsgen.defaultXor);
 
 	state.builtin_symbols && Object.keys(state.builtin_symbols).forEach(function(key) {
 		externs.push('EXPORTAPI JSValueRef '+key+'(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception);');
@@ -319,10 +353,21 @@ function generateSourceEmbed (library, options, state, platform_lib, filemap, ex
 		var pathNoExt = fe.filename.replace(/\.js(on)?$/,''),
 			id = fe.id || path.basename(pathNoExt),
 			fn = (options.moduleid ? '/'+options.moduleid : '') + fe.filename,
-			compare = 'if (filepath.find("'+fn+'")==0)',
+			compare = 'if (filepath=="'+fn+'")',
 			varname = generateVarname(id),
 			debugfn = options.debugsource && path.join(options.srcdir,fn),
-			genjs = fe.json;
+			// IR modules reach module, exports and require through the global object.
+			// off by default: in a wrapper, top level var and function declarations
+			// no longer become properties of the global object
+			wrap = !fe.ir && !!options['module-wrapper'];
+		if (pack && !fe.ir && !(fe.symbols && fe.symbols.length) && !(fe.cleanup && fe.cleanup.length)) {
+			var encoded = jsgen.encode(fe.source,format,debugfn);
+			for (var c=0;!characters && c<encoded.length;c++) {
+				encoded[c] ^= key;
+			}
+			pack[fn] = {source:encoded, json:!!fe.json, utf16:characters, wrapped:wrap};
+			return;
+		}
 		ecode.push('\t'+compare);
 		ecode.push('\t{');
 		if (fe.json) {
@@ -330,7 +375,7 @@ function generateSourceEmbed (library, options, state, platform_lib, filemap, ex
 			ecode.push('\t\tif (result==nullptr)');
 			ecode.push('\t\t{');
 			var n = jsgen.makeVariableName();
-			generateDecode(varname,'\t\t\t',ecode,n);
+			generateDecode(varname,'\t\t\t',ecode,n,characters);
 			ecode.push('\t\t\tresult = JSValueMakeFromJSONString(ctx,'+n+');');
 			ecode.push('\t\t\tJSStringRelease('+n+');');
 			ecode.push('\t\t}');
@@ -338,28 +383,52 @@ function generateSourceEmbed (library, options, state, platform_lib, filemap, ex
 				ecode.push('\t\t\t'+cl);
 			});
 			ecode.push('\t\treturn result;');
-			var define = jsgen.generateDefine(varname,jsgen.transform(fe.source,null,null,debugfn));
+			var define = jsgen.generateDefine(varname,embed(fe.source,debugfn),type);
 			defines.push('// '+fn+'\n'+define);
 		}
 		else {
-			generateRequire(state,'\t\t',fe.ir,id,fe.filename,fe.dirname,fe.symbols,fe.symbolnames,fe.cleanup,fe.source,ecode,varname,options.moduleid,options.debugsource);
+			generateRequire(state,'\t\t',fe.ir,id,fe.filename,fe.dirname,fe.symbols,fe.symbolnames,fe.cleanup,fe.source,ecode,varname,options.moduleid,options.debugsource,wrap,characters,constants);
 			if (!fe.ir) {
-				var define = jsgen.generateDefine(varname,jsgen.transform(fe.source,null,null,debugfn));
+				var define = jsgen.generateDefine(varname,embed(fe.source,debugfn),type);
 				defines.push('// '+fn+'\n'+define);
-				genjs = true;
 			}
 		}
 		ecode.push('\t}');
 		mapping.push({filename:fn,varname:varname});
-		genjs && decoders.push(jsgen.generateDecoder(varname));
 		varnames.push(fn);
 	});
 
+	var requires = generateRequireTable(filemap, options.moduleid),
+		packages = generatePackageMainTable(filemap, options.moduleid),
+		graph = generatePrefetchGraph(filemap, options.moduleid, mapping);
+
+	if (pack) {
+		// the pack has every module so it can carry the whole require graph
+		var packEntries = filemap.map(function(fe,i){
+			var fn = graph[i].path;
+			return {
+				path: fn,
+				hash: pathHash(fn),
+				filename: fe.filename,
+				dirname: fe.dirname,
+				source: pack[fn] ? pack[fn].source : null,
+				json: !!fe.json,
+				utf16: pack[fn] ? pack[fn].utf16 : false,
+				wrapped: pack[fn] ? pack[fn].wrapped : false,
+				dependencies: graph[i].dependencies
+			};
+		});
+		fs.writeFileSync(path.join(options.dest,packName),sourcepack.write(packEntries));
+		graph = [];
+	}
+	else if (characters) {
+		// UTF-16 sources have nothing to prefetch
+		graph = [];
+	}
+
 	code.push(jsgen.generateBody(null, options.xor, defines));
 	code.push('');
 
-	code = code.concat(decoders);
-
 	externs.length && code.push('// externs');
 	externs.forEach(function(e){
 		e = /^EXPORTAPI/.test(e) ? e : 'EXPORTAPI '+e;
@@ -367,32 +436,363 @@ function generateSourceEmbed (library, options, state, platform_lib, filemap, ex
 	});
 	code.push('');
 
+	constants.size && code.push(constants.toNative());
+
 	code = code.concat(ecode);
 
+	if (pack) {
+		code.push('\t// sources in the source pack');
+		code.push('\t{');
+		if (state.builtin_symbols) {
+			// they stay in the global object once set
+			code.push('\t\tstatic bool builtins = false;');
+			code.push('\t\tif (!builtins)');
+			code.push('\t\t{');
+			code.push('\t\t\tauto object = JSContextGetGlobalObject(ctx);');
+			generateBuiltinSymbols(state,'\t\t\t',code);
+			code.push('\t\t\tbuiltins = true;');
+			code.push('\t\t}');
+		}
+		code.push('\t\tauto result = HyperloopLoadSourcePack(ctx,parent,path,exception);');
+		code.push('\t\tif (result!=nullptr)');
+		code.push('\t\t{');
+		code.push('\t\t\treturn result;');
+		code.push('\t\t}');
+		code.push('\t}');
+	}
+
 	code.push('\tauto msg = std::string("Cannot find module \'");');
 	code.push('\tmsg+=filepath;');
 	code.push('\tmsg+=std::string("\'");');
 	code.push('\tauto result = HyperloopMakeException(ctx,msg.c_str());');
 	code.push('\tauto msgStr = HyperloopMakeString(ctx,"MODULE_NOT_FOUND",0);');
-	code.push('\tauto code = JSStringCreateWithUTF8CString("code");');
 	code.push('\tauto obj = JSValueToObject(ctx,result,0);');
-	code.push('\tJSObjectSetProperty(ctx, obj, code, msgStr, 0, 0);');
-	code.push('\tJSStringRelease(code);');
+	code.push('\tJSObjectSetProperty(ctx, obj, HyperloopWellKnownString(kHyperloopString_code), msgStr, 0, 0);');
 	code.push('\t*exception = result;');
 	code.push('\treturn JSValueMakeUndefined(ctx);');
 	code.push('}');
 
 	code.push('');
 
+	var entries = 'HyperloopTranslationUnitEntries_'+moduleid;
+	if (varnames.length) {
+		code.push('static const HyperloopTranslationUnitEntry '+entries+'[] = {');
+		varnames.forEach(function(v,i){
+			var length = Buffer.byteLength(v,'utf8');
+			code.push('\t{ "'+v+'", '+length+', 0x'+pathHash(v).toString(16)+'u }'+(i+1<varnames.length?',':''));
+		});
+		code.push('};');
+		code.push('');
+	}
+
+	var requireEntries = 'HyperloopRequireEntries_'+moduleid;
+	if (requires.length) {
+		code.push('static const HyperloopRequireEntry '+requireEntries+'[] = {');
+		requires.forEach(function(r,i){
+			var length = Buffer.byteLength(r.path,'utf8');
+			code.push('\t{ "'+r.dirname+'", "'+r.request+'", "'+r.path+'", '+length+', 0x'+requireHash(r.dirname,r.request).toString(16)+'u }'+(i+1<requires.length?',':''));
+		});
+		code.push('};');
+		code.push('');
+	}
+
+	var packageEntries = 'HyperloopPackageMainEntries_'+moduleid;
+	if (packages.length) {
+		code.push('static const HyperloopPackageMainEntry '+packageEntries+'[] = {');
+		packages.forEach(function(p,i){
+			var length = Buffer.byteLength(p.directory,'utf8'),
+				main = p.main ? '"'+p.main+'", '+Buffer.byteLength(p.main,'utf8') : 'nullptr, 0';
+			code.push('\t{ "'+p.directory+'", '+length+', 0x'+pathHash(p.directory).toString(16)+'u, '+main+' }'+(i+1<packages.length?',':''));
+		});
+		code.push('};');
+		code.push('');
+	}
+
+	var prefetchEntries = 'HyperloopPrefetchEntries_'+moduleid,
+		prefetchDependencies = 'HyperloopPrefetchDependencies_'+moduleid,
+		dependencies = [];
+	if (graph.length) {
+		graph.forEach(function(g){
+			g.offset = dependencies.length;
+			dependencies = dependencies.concat(g.dependencies);
+		});
+		dependencies.length && code.push('static const size_t '+prefetchDependencies+'[] = { '+dependencies.join(', ')+' };');
+		code.push('static const HyperloopPrefetchEntry '+prefetchEntries+'[] = {');
+		graph.forEach(function(g,i){
+			var source = g.varname ? g.varname+', '+g.varname+'_length' : 'nullptr, 0',
+				deps = g.dependencies.length ? prefetchDependencies+' + '+g.offset+', '+g.dependencies.length : 'nullptr, 0';
+			code.push('\t{ "'+g.path+'", '+source+', '+deps+' }'+(i+1<graph.length?',':''));
+		});
+		code.push('};');
+		code.push('');
+	}
+
 	code.push('EXPORTAPI void HyperloopInitialize_'+moduleid+'()');
 	code.push('{');
-	code.push('\tHyperloopRegisterTranslationUnit(&HyperloopLoadEmbedSource,'+varnames.length+','+(varnames.map(function(v){return '"'+v+'"';}).join(',') || '""') +');');
+	code.push('\tHyperloopRegisterTranslationUnitIndex(&HyperloopLoadEmbedSource,'+(varnames.length ? entries : 'nullptr')+','+varnames.length+');');
+	requires.length && code.push('\tHyperloopRegisterRequireTable('+requireEntries+','+requires.length+');');
+	packages.length && code.push('\tHyperloopRegisterPackageMainTable('+packageEntries+','+packages.length+');');
+	graph.length && code.push('\tHyperloopRegisterPrefetchGraph('+prefetchEntries+','+graph.length+',_HL_XOR);');
+	if (pack) {
+		// without the pack none of its sources can be required, so say why
+		code.push('\tif (!HyperloopRegisterSourcePack(&HyperloopLoadEmbedSource,"'+packName+'",_HL_XOR))');
+		code.push('\t{');
+		code.push('\t\tstatic const char message[] = "couldn\'t load source pack '+packName+'";');
+		code.push('\t\tHyperloopLog(message,sizeof(message)-1);');
+		code.push('\t}');
+	}
 	code.push('}');
 	code.push('');
 
 	library.writeSourceFile(options, platform_lib, fn, code, true);
 }
 
+/**
+ * 32-bit FNV-1a hash of the UTF-8 bytes of a source path, must match HyperloopPathHash
+ */
+function pathHash(path, seed) {
+	var bytes = new Buffer(path,'utf8'),
+		hash = seed===undefined ? 0x811c9dc5 : seed;
+	for (var c=0;c<bytes.length;c++) {
+		hash ^= bytes[c];
+		hash = (hash + (hash<<1) + (hash<<4) + (hash<<7) + (hash<<8) + (hash<<24)) >>> 0;
+	}
+	return hash;
+}
+
+/**
+ * hash of a require table key, must match HyperloopRequireHash
+ */
+function requireHash(dirname, request) {
+	return pathHash(request, pathHash('\0', pathHash(dirname)));
+}
+
+/**
+ * the runtime's PathResolve, path.resolve on posix paths
+ */
+function runtimePathResolve(dir, p) {
+	return (path.posix || path).resolve('/', dir, p);
+}
+
+/**
+ * return the path the main of the package.json embedded as fe in directory
+ * resolves to, undefined when it has none
+ */
+function packageMain(directory, fe) {
+	try {
+		var main = JSON.parse(fe.source).main;
+		if (typeof(main)==='string') {
+			return runtimePathResolve(directory,main);
+		}
+	}
+	catch (E) {
+		// the runtime doesn't find a main either
+	}
+}
+
+/**
+ * return a {directory,main} for every package.json embedded in this unit so the
+ * runtime never has to parse one to find the entry point of a package
+ */
+function generatePackageMainTable(filemap, moduleid) {
+	var table = [],
+		literal = /^[\x20-\x7e]*$/,
+		suffix = '/package.json';
+	filemap.forEach(function(fe){
+		var fn = (moduleid ? '/'+moduleid : '') + fe.filename;
+		if (!fe.json || fn.slice(-suffix.length)!==suffix) {
+			return;
+		}
+		var directory = fn.slice(0,-suffix.length) || '/',
+			main = packageMain(directory,fe);
+		if (!literal.test(directory) || /["\\?]/.test(directory)) {
+			return;
+		}
+		if (main && (!literal.test(main) || /["\\?]/.test(main))) {
+			// leave this package to the runtime
+			return;
+		}
+		table.push({directory:directory, main:main});
+	});
+	return table;
+}
+
+/**
+ * resolve request from a module in dirname the way requestResolve in require.cpp
+ * would against the files embedded in this translation unit. returns undefined
+ * when it doesn't resolve here so the runtime decides. when probes is given,
+ * every path the runtime would check for is pushed to it in order
+ */
+function resolveRequire(files, dirname, request, probes) {
+	function exists(p) {
+		probes && probes.push(p);
+		return p in files;
+	}
+	function loadAsFile(p) {
+		var candidates = [p, p+'.js', p+'.json'];
+		for (var i=0;i<candidates.length;i++) {
+			if (exists(candidates[i])) {
+				return candidates[i];
+			}
+		}
+	}
+	function loadAsDirectory(p) {
+		var pkg = exists(p+'/package.json') && files[p+'/package.json'],
+			main = pkg && packageMain(p,pkg);
+		if (main) {
+			return main;
+		}
+		if (exists(p+'/index.js')) {
+			return p+'/index.js';
+		}
+	}
+	function requirePaths() {
+		if (dirname == '/') {
+			return ['/node_modules'];
+		}
+		var parts = runtimePathResolve(dirname,'.').split('/').filter(Boolean);
+		return parts.map(function(part,i){
+			return '/'+parts.slice(0,i+1).join('/')+'/node_modules';
+		});
+	}
+	function loadAsModule() {
+		var paths = requirePaths(),
+			found;
+		for (var i=0;i<paths.length && !found;i++) {
+			var candidate = runtimePathResolve(paths[i],request);
+			found = loadAsFile(candidate) || loadAsDirectory(candidate);
+		}
+		return found;
+	}
+	if (request.charAt(0)!='/' && !/^\.\.?(\/|$)/.test(request)) {
+		return loadAsModule();
+	}
+	var resolved = runtimePathResolve(dirname,request);
+	return loadAsFile(resolved) || loadAsDirectory(resolved);
+}
+
+/**
+ * return the string literal require targets in source
+ */
+function findRequires(source) {
+	var requests = [],
+		ast;
+	try {
+		ast = Uglify.parse(source);
+	}
+	catch (E) {
+		return requests;
+	}
+	ast.walk(new Uglify.TreeWalker(function(node){
+		if (node instanceof Uglify.AST_Call && node.expression instanceof Uglify.AST_SymbolRef &&
+			node.expression.name=='require' && node.args.length==1 && node.args[0] instanceof Uglify.AST_String) {
+			requests.indexOf(node.args[0].value)<0 && requests.push(node.args[0].value);
+		}
+	}));
+	return requests;
+}
+
+/**
+ * return the string literal require targets of an embedded source, found once
+ */
+function requestsOf(fe) {
+	if (!fe.requests) {
+		fe.requests = fe.json || !fe.source ? [] : findRequires(fe.source);
+	}
+	return fe.requests;
+}
+
+/**
+ * return the embedded files and, for each, the indexes of the files its string
+ * literal requires resolve to. the runtime decodes this graph ahead of require
+ */
+function generatePrefetchGraph(filemap, moduleid, mapping) {
+	var files = {},
+		indexes = {},
+		varnames = {};
+	mapping.forEach(function(m){
+		varnames[m.filename] = m.varname;
+	});
+	filemap.forEach(function(fe,i){
+		var fn = (moduleid ? '/'+moduleid : '') + fe.filename;
+		files[fn] = fe;
+		indexes[fn] = i;
+	});
+	return filemap.map(function(fe){
+		var fn = (moduleid ? '/'+moduleid : '') + fe.filename,
+			dirname = fe.dirname=='.' ? '/' : fe.dirname,
+			dependencies = [];
+		requestsOf(fe).forEach(function(request){
+			var resolved = resolveRequire(files, dirname, request);
+			resolved in indexes && dependencies.indexOf(indexes[resolved])<0 && dependencies.push(indexes[resolved]);
+		});
+		return {
+			path: fn,
+			varname: fe.ir ? null : varnames[fn],
+			dependencies: dependencies
+		};
+	});
+}
+
+/**
+ * return a test for the paths no other translation unit or source pack can
+ * embed. a module embeds its files under /<moduleid>, so it owns that directory.
+ * the app owns the root level files and the top level directories it embeds
+ * files in
+ */
+function ownedPaths(files, moduleid) {
+	if (moduleid) {
+		var prefix = '/'+moduleid+'/';
+		return function(p) {
+			return p.indexOf(prefix)===0;
+		};
+	}
+	var directories = {};
+	Object.keys(files).forEach(function(fn){
+		var end = fn.indexOf('/',1);
+		end > 0 && (directories[fn.slice(0,end)] = true);
+	});
+	return function(p) {
+		var end = p.indexOf('/',1);
+		return end < 0 || p.slice(0,end) in directories;
+	};
+}
+
+/**
+ * run the require resolution of every string literal require in the embedded
+ * sources at build time. returns a {dirname,request,path} per resolved request.
+ * the runtime trusts these over its own resolution, so a request is left out
+ * when a path it probes could be embedded by another unit
+ */
+function generateRequireTable(filemap, moduleid) {
+	var files = {},
+		seen = {},
+		table = [],
+		literal = /^[\x20-\x7e]*$/,
+		owned;
+	filemap.forEach(function(fe){
+		files[(moduleid ? '/'+moduleid : '') + fe.filename] = fe;
+	});
+	owned = ownedPaths(files, moduleid);
+	filemap.forEach(function(fe){
+		if (fe.json || !fe.source) {
+			return;
+		}
+		var dirname = fe.dirname=='.' ? '/' : fe.dirname;
+		requestsOf(fe).forEach(function(request){
+			var key = dirname+'\0'+request;
+			if (key in seen || !literal.test(dirname) || !literal.test(request) || /["\\?]/.test(request)) {
+				return;
+			}
+			seen[key] = true;
+			var probes = [],
+				resolved = resolveRequire(files, dirname, request, probes);
+			resolved && probes.every(owned) && literal.test(resolved) && !/["\\?]/.test(resolved) && table.push({dirname:dirname, request:request, path:resolved});
+		});
+	});
+	return table;
+}
+
 function generateHeader (options, state, obj) {
 	var code = [];
 	code.push(util.HEADER);
@@ -429,10 +829,9 @@ function generateMain (options, state, obj, symbols, symbolnames, externs, clean
 			symbolname = symbol.symbolname;
 		symbolnames.push(name);
 		symbols.push('// '+symbolname);
-		symbols.push('auto '+name+'Property = JSStringCreateWithUTF8CString("'+name+'");');
+		symbols.push('auto '+name+'Property = HyperloopInternString("'+name+'");');
 		symbols.push('auto '+name+'Fn = JSObjectMakeFunctionWithCallback(ctx,'+name+'Property,'+symbolname+');');
 		symbols.push('JSObjectSetProperty(ctx,object,'+name+'Property,'+name+'Fn,kJSPropertyAttributeReadOnly|kJSPropertyAttributeDontEnum|kJSPropertyAttributeDontDelete,nullptr);');
-		cleanup.push('JSStringRelease('+name+'Property);');
 		symbols.push('');
 		externs.push('EXPORTAPI JSValueRef '+symbolname+'(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception);');
 	});
@@ -440,10 +839,9 @@ function generateMain (options, state, obj, symbols, symbolnames, externs, clean
 	if (state.custom_properties) {
 		state.custom_properties.forEach(function(name){
 			symbols.push('// '+name);
-			symbols.push('auto '+name+'Property = JSStringCreateWithUTF8CString("'+name+'");');
+			symbols.push('auto '+name+'Property = HyperloopInternString("'+name+'");');
 			symbols.push('auto '+name+'Fn = JSObjectMakeFunctionWithCallback(ctx,'+name+'Property,'+name+');');
 			symbols.push('JSObjectSetProperty(ctx,object,'+name+'Property,'+name+'Fn,kJSPropertyAttributeReadOnly|kJSPropertyAttributeDontEnum|kJSPropertyAttributeDontDelete,nullptr);');
-			cleanup.push('JSStringRelease('+name+'Property);');
 			symbols.push('');
 			externs.push('EXPORTAPI JSValueRef '+name+'(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception);');
 		});
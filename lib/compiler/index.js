@@ -5,6 +5,8 @@ module.exports = {
 	IR: require('./IR'),
 	jsgen: require('./jsgen'),
 	library: require('./library'),
+	lz4: require('./lz4'),
+	sourcepack: require('./sourcepack'),
 	type: require('./type'),
 	ast: require('./ast')
 };
\ No newline at end of file
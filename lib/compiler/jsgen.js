@@ -3,6 +3,7 @@
  */
 var fs = require('fs'),
 	util = require('../util'),
+	lz4 = require('./lz4'),
 	log = require('../log'),
 	defaultXor = '0xAC',
 	symbolsCache = {},
@@ -10,6 +11,10 @@ var fs = require('fs'),
 	symbolAlpha = 'abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ';
 
 exports.transform = transform;
+exports.compress = compress;
+exports.characters = characters;
+exports.encode = encode;
+exports.defaultXor = defaultXor;
 exports.generateDecoder = generateDecoder;
 exports.generateDefine = generateDefine;
 exports.generateBody = generateBody;
@@ -88,8 +93,8 @@ function generateSetterName(classname, property) {
 	return sanitizeClassName(classname)+'_Set_'+property;
 }
 
-function generateDefine(varname, srccode) {
-	return 'static const char '+varname+'[] = {\n\t' + srccode.source + '\n};\n'+
+function generateDefine(varname, srccode, type) {
+	return 'static const '+(type || 'char')+' '+varname+'[] = {\n\t' + srccode.source + '\n};\n'+
 		   'static const size_t '+varname+'_length = '+srccode.length+';\n';
 }
 
@@ -118,18 +123,11 @@ function generateBody(header, xor, defines) {
 		  (Array.isArray(defines) ? defines.join('\n') : defines);
 }
 
-function transform(srccode, split, transformer, debugfn) {
-	var output = '',
-		count = 0,
-		inComment = false,
-		input = '';
-
-	if (typeof(split)==='function') {
-		transformer = split;
-		split = null;
-	}
-
-	split = split || 10;
+/**
+ * strip blank lines and indentation from the source we embed
+ */
+function prepareSource(srccode, debugfn) {
+	var input = '';
 
 	srccode.split(/\n/g).forEach(function(line){
 		line = line.trim();
@@ -144,8 +142,24 @@ function transform(srccode, split, transformer, debugfn) {
 	// log our our debug source
 	debugfn && fs.writeFileSync(debugfn, input, 'utf8');
 
+	return input;
+}
+
+function transform(srccode, split, transformer, debugfn) {
+	var output = '',
+		count = 0,
+		inComment = false,
+		input;
+
+	if (typeof(split)==='function') {
+		transformer = split;
+		split = null;
+	}
+
+	split = split || 10;
+
 	// convert to base64
-	input = new Buffer(input).toString('base64');
+	input = new Buffer(prepareSource(srccode, debugfn)).toString('base64');
 
 	// supply a transformer
 	transformer = transformer || function(value) {
@@ -184,6 +198,84 @@ function transform(srccode, split, transformer, debugfn) {
 	};
 }
 
+/**
+ * return the bytes embedded for a source before they are obfuscated, base64
+ * or LZ4 compressed. a compressed source starts with a marker byte base64
+ * never produces, a flags byte (1 when the source is ASCII so it can expand
+ * straight to UTF-16) and the UTF-8 length as a LEB128 varint. see
+ * templates/lz4.h. format is 'lz4' (or true) to compress, 'utf16' for the
+ * little endian UTF-16 code units and anything else for base64
+ */
+function encode(srccode, format, debugfn) {
+	if (format === 'utf16') {
+		return new Buffer(prepareSource(srccode, debugfn), 'utf16le');
+	}
+
+	var input = new Buffer(prepareSource(srccode, debugfn), 'utf8'),
+		ascii = 1,
+		header = [0xFF],
+		i;
+
+	if (format !== true && format !== 'lz4') {
+		return new Buffer(input.toString('base64'));
+	}
+
+	for (i = 0; i < input.length && ascii; i++) {
+		ascii = input[i] < 0x80 ? 1 : 0;
+	}
+	header.push(ascii);
+	for (i = input.length; i >= 0x80; i = Math.floor(i / 0x80)) {
+		header.push((i & 0x7F) | 0x80);
+	}
+	header.push(i);
+
+	return Buffer.concat([new Buffer(header), lz4.compress(input)]);
+}
+
+/**
+ * like transform but embeds the source LZ4 compressed
+ */
+function compress(srccode, split, debugfn) {
+	var bytes = encode(srccode, true, debugfn),
+		output = '';
+
+	split = split || 10;
+
+	for (var i = 0; i < bytes.length; i++) {
+		if (i != 0) output+=', ';
+		if ((i % split) === 0) output+='\n\t';
+		output+='_(0x'+(bytes[i] < 0x10 ? '0' : '')+bytes[i].toString(16)+')';
+	}
+
+	return {
+		source: output.trim(),
+		length: bytes.length
+	};
+}
+
+/**
+ * like transform but embeds the source as the UTF-16 code units JavaScriptCore
+ * takes, so nothing is decoded when it loads. the source is not obfuscated
+ */
+function characters(srccode, split, debugfn) {
+	var input = prepareSource(srccode, debugfn),
+		output = '';
+
+	split = split || 10;
+
+	for (var i = 0; i < input.length; i++) {
+		var hex = input.charCodeAt(i).toString(16);
+		if (i != 0) output+=', ';
+		if ((i % split) === 0) output+='\n\t';
+		output+='0x'+'0000'.substr(hex.length)+hex;
+	}
+
+	return {
+		source: output.trim(),
+		length: input.length
+	};
+}
+
 var vars = 0;
 
 function makeVariableName() {
@@ -522,7 +522,18 @@ function compileType(options, metabase, state, library, typename, type, code) {
 			declare.length && declare.forEach(function(c){code.push(c)});
 	}
 	else {
+		body.push('#if HL_WRAPPER_CACHE');
+		body.push('\tauto cached = HyperloopWrapperCacheGet(ctx,HyperloopWrapperKey(value),Register'+typeobj.toName()+'());');
+		body.push('\tif (cached)');
+		body.push('\t{');
+		body.push('\t\treturn cached;');
+		body.push('\t}');
+		body.push('\tauto object = JSObjectMake(ctx,Register'+typeobj.toName()+'(),new Hyperloop::NativeObject<'+cast+'>(value));');
+		body.push('\tHyperloopWrapperCachePut(ctx,HyperloopWrapperKey(value),Register'+typeobj.toName()+'(),object);');
+		body.push('\treturn object;');
+		body.push('#else');
 		body.push('\treturn JSObjectMake(ctx,Register'+typeobj.toName()+'(),new Hyperloop::NativeObject<'+cast+'>(value));');
+		body.push('#endif');
 	}
 	body.push('}');	
 	body.push('');
@@ -1061,8 +1072,26 @@ function generateCode(options,state,symboltable,arch,nodefail) {
 				clscode.push('EXPORTAPI JSValueRef '+mangledClassname+'_ToJSValue(JSContextRef ctx, '+cast+' instance, JSValueRef *exception)');
 				clscode.push('{');
 				typeobj.toNullCheck('instance','\t',clscode);
-				clscode.push('\tauto po = new Hyperloop::NativeObject'+typeobj.getNewNativeObjectCast('instance')+';');
-				clscode.push('\treturn JSObjectMake(ctx, RegisterClass(), po);');
+				if (typeobj._was_not_pointer_obj) {
+					// the wrapper owns a copy of the value, so there is no identity to preserve
+					clscode.push('\tauto po = new Hyperloop::NativeObject'+typeobj.getNewNativeObjectCast('instance')+';');
+					clscode.push('\treturn JSObjectMake(ctx, RegisterClass(), po);');
+				}
+				else {
+					clscode.push('#if HL_WRAPPER_CACHE');
+					clscode.push('\tauto cached = HyperloopWrapperCacheGet(ctx, HyperloopWrapperKey(instance), RegisterClass());');
+					clscode.push('\tif (cached)');
+					clscode.push('\t{');
+					clscode.push('\t\treturn cached;');
+					clscode.push('\t}');
+					clscode.push('#endif');
+					clscode.push('\tauto po = new Hyperloop::NativeObject'+typeobj.getNewNativeObjectCast('instance')+';');
+					clscode.push('\tauto object = JSObjectMake(ctx, RegisterClass(), po);');
+					clscode.push('#if HL_WRAPPER_CACHE');
+					clscode.push('\tHyperloopWrapperCachePut(ctx, HyperloopWrapperKey(instance), RegisterClass(), object);');
+					clscode.push('#endif');
+					clscode.push('\treturn object;');
+				}
 				clscode.push('}');
 				clscode.push('');
 
@@ -1075,10 +1104,16 @@ function generateCode(options,state,symboltable,arch,nodefail) {
 				clscode.push('\t\t*exception = HyperloopMakeException(ctx,"couldn\'t update object to '+classname+'");');
 				clscode.push('\t\treturn valueObj;');
 				clscode.push('\t}');
+				clscode.push('#if HL_WRAPPER_CACHE');
+				clscode.push('\tHyperloopWrapperCacheRemove(ctx, HyperloopWrapperKey(ToNative(object)->getObject()), RegisterClass(), object);');
+				clscode.push('#endif');
 				clscode.push('\tToNative(object)->release();');
 				clscode.push('\tauto po = new Hyperloop::NativeObject'+typeobj.getNewNativeObjectCast('instance')+';');
 				clscode.push('\tpo->retain();');
 				clscode.push('\tJSObjectSetPrivate(object, po);');
+				clscode.push('#if HL_WRAPPER_CACHE');
+				clscode.push('\tHyperloopWrapperCachePut(ctx, HyperloopWrapperKey(instance), RegisterClass(), object);');
+				clscode.push('#endif');
 				clscode.push('\treturn valueObj;');
 				clscode.push('}');
 				clscode.push('');
@@ -0,0 +1,164 @@
+/**
+ * LZ4 block compression for embedded sources
+ */
+var MIN_MATCH = 4,
+	MAX_OFFSET = 65535,
+	// the format requires the last 5 bytes to be literals and the last match
+	// to start at least 12 bytes before the end of the block
+	LAST_LITERALS = 5,
+	MATCH_LIMIT = 12,
+	HASH_LOG = 16,
+	// how many earlier positions with the same hash are tried. this runs at
+	// build time so it favours ratio over speed
+	MAX_CHAIN = 64;
+
+var imul = Math.imul || function(a, b) {
+	var ah = (a >>> 16) & 0xffff,
+		al = a & 0xffff;
+	return ((al * b) + (((ah * b) << 16) >>> 0)) | 0;
+};
+
+exports.compress = compress;
+exports.decompress = decompress;
+
+function hash(input, i) {
+	var v = input[i] | (input[i+1] << 8) | (input[i+2] << 16) | (input[i+3] << 24);
+	return imul(v, -1640531535) >>> (32 - HASH_LOG);
+}
+
+function writeLength(output, length) {
+	while (length >= 255) {
+		output.push(255);
+		length -= 255;
+	}
+	output.push(length);
+}
+
+function writeSequence(output, input, start, literals, offset, match) {
+	var m = match - MIN_MATCH;
+	output.push((Math.min(literals, 15) << 4) | Math.min(m, 15));
+	literals >= 15 && writeLength(output, literals - 15);
+	for (var c = 0; c < literals; c++) {
+		output.push(input[start + c]);
+	}
+	output.push(offset & 0xff, offset >> 8);
+	m >= 15 && writeLength(output, m - 15);
+}
+
+function writeLastLiterals(output, input, start) {
+	var literals = input.length - start;
+	output.push(Math.min(literals, 15) << 4);
+	literals >= 15 && writeLength(output, literals - 15);
+	for (var c = 0; c < literals; c++) {
+		output.push(input[start + c]);
+	}
+}
+
+/**
+ * compress the input buffer into an LZ4 block, greedily taking the longest
+ * match found in a hash chain of the last 64KB
+ */
+function compress(input) {
+	var length = input.length,
+		limit = length - MATCH_LIMIT,
+		head = new Int32Array(1 << HASH_LOG),
+		chain = new Int32Array(Math.max(length, 1)),
+		output = [],
+		anchor = 0,
+		i = 0,
+		h;
+
+	for (h = 0; h < head.length; h++) {
+		head[h] = -1;
+	}
+
+	function insert(position) {
+		var h = hash(input, position);
+		chain[position] = head[h];
+		head[h] = position;
+		return chain[position];
+	}
+
+	while (i <= limit) {
+		var candidate = insert(i),
+			max = length - LAST_LITERALS - i,
+			best = 0,
+			offset = 0,
+			depth = MAX_CHAIN;
+
+		while (candidate >= 0 && i - candidate <= MAX_OFFSET && depth--) {
+			// a candidate can only be better if it also matches at the current best length
+			if (input[candidate + best] === input[i + best]) {
+				var len = 0;
+				while (len < max && input[candidate + len] === input[i + len]) {
+					len++;
+				}
+				if (len > best) {
+					best = len;
+					offset = i - candidate;
+					if (best === max) {
+						break;
+					}
+				}
+			}
+			candidate = chain[candidate];
+		}
+
+		if (best < MIN_MATCH) {
+			i++;
+			continue;
+		}
+
+		writeSequence(output, input, anchor, i - anchor, offset, best);
+		for (var j = i + 1; j < i + best && j <= limit; j++) {
+			insert(j);
+		}
+		i += best;
+		anchor = i;
+	}
+
+	writeLastLiterals(output, input, anchor);
+
+	return new Buffer(output);
+}
+
+/**
+ * decompress an LZ4 block made by compress
+ */
+function decompress(block, size) {
+	var output = new Buffer(size),
+		written = 0,
+		i = 0,
+		b;
+
+	while (i < block.length) {
+		var token = block[i++],
+			literals = token >> 4;
+		if (literals === 15) {
+			do {
+				b = block[i++];
+				literals += b;
+			} while (b === 255);
+		}
+		block.copy(output, written, i, i + literals);
+		i += literals;
+		written += literals;
+		if (i >= block.length) {
+			break;
+		}
+		var offset = block[i] | (block[i+1] << 8),
+			match = (token & 15) + MIN_MATCH;
+		i += 2;
+		if ((token & 15) === 15) {
+			do {
+				b = block[i++];
+				match += b;
+			} while (b === 255);
+		}
+		for (var c = 0; c < match; c++, written++) {
+			output[written] = output[written - offset];
+		}
+	}
+
+	return output.slice(0, written);
+}
@@ -0,0 +1,124 @@
+/**
+ * source pack generation, see templates/sourcepack.h for the format
+ */
+var MAGIC = 'HLPK',
+	VERSION = 1,
+	HEADER_SIZE = 16,
+	ENTRY_SIZE = 40,
+	JSON_FLAG = 0x01,
+	UTF16_FLAG = 0x02,
+	WRAPPED_FLAG = 0x04;
+
+exports.write = write;
+exports.read = read;
+
+/**
+ * return the pack for entries of {path, hash, filename, dirname, source, json,
+ * utf16, wrapped, dependencies}. source is the obfuscated encoded source, the
+ * UTF-16LE code units when utf16 is set, or null for a module compiled into the
+ * app. wrapped modules are evaluated in a function wrapper.
+ * dependencies are indexes into entries. the index is sorted by hash and then
+ * path so the runtime can binary search it
+ */
+function write(entries) {
+	var order = entries.map(function(e,i){ return i; }).sort(function(a,b){
+			var x = entries[a], y = entries[b];
+			return x.hash - y.hash || (x.path < y.path ? -1 : x.path > y.path ? 1 : 0);
+		}),
+		position = [],
+		chunks = [],
+		offset = HEADER_SIZE + entries.length * ENTRY_SIZE,
+		index = new Buffer(offset),
+		strings = {};
+
+	order.forEach(function(original,sorted){
+		position[original] = sorted;
+	});
+
+	function append(buffer) {
+		var at = offset;
+		chunks.push(buffer);
+		offset += buffer.length;
+		return at;
+	}
+
+	function align(size) {
+		offset % size && append(new Buffer([0,0,0].slice(0, size - offset % size)));
+	}
+
+	function string(str) {
+		if (!(str in strings)) {
+			strings[str] = append(Buffer.concat([new Buffer(str,'utf8'), new Buffer([0])]));
+		}
+		return strings[str];
+	}
+
+	index.write(MAGIC, 0, 'ascii');
+	index.writeUInt32LE(VERSION, 4);
+	index.writeUInt32LE(entries.length, 8);
+	index.writeUInt32LE(0, 12);
+
+	order.forEach(function(original,sorted){
+		var e = entries[original],
+			at = HEADER_SIZE + sorted * ENTRY_SIZE,
+			path = string(e.path),
+			filename = string(e.filename),
+			dirname = string(e.dirname),
+			source = 0,
+			dependencies = 0;
+
+		if (e.source) {
+			// UTF-16 sources are used in place so they are JSChar aligned
+			e.utf16 && align(2);
+			source = append(e.source);
+		}
+
+		if (e.dependencies.length) {
+			// dependency lists are uint32 aligned
+			align(4);
+			var deps = new Buffer(e.dependencies.length * 4);
+			e.dependencies.forEach(function(d,i){
+				deps.writeUInt32LE(position[d], i * 4);
+			});
+			dependencies = append(deps);
+		}
+
+		[e.hash, path, Buffer.byteLength(e.path,'utf8'), filename, dirname, source, e.source ? e.source.length : 0,
+			(e.json ? JSON_FLAG : 0) | (e.utf16 ? UTF16_FLAG : 0) | (e.wrapped ? WRAPPED_FLAG : 0), dependencies, e.dependencies.length].forEach(function(value,i){
+			index.writeUInt32LE(value >>> 0, at + i * 4);
+		});
+	});
+
+	return Buffer.concat([index].concat(chunks));
+}
+
+/**
+ * return the entries of a pack made by write, in index order
+ */
+function read(pack) {
+	if (pack.toString('ascii', 0, 4) !== MAGIC || pack.readUInt32LE(4) !== VERSION) {
+		throw new Error('not a source pack');
+	}
+	var entries = [];
+	for (var c = 0, count = pack.readUInt32LE(8); c < count; c++) {
+		var at = HEADER_SIZE + c * ENTRY_SIZE,
+			field = function(i) { return pack.readUInt32LE(at + i * 4); },
+			str = function(offset) { return pack.toString('utf8', offset, Array.prototype.indexOf.call(pack, 0, offset)); },
+			dependencies = [];
+		for (var d = 0; d < field(9); d++) {
+			dependencies.push(pack.readUInt32LE(field(8) + d * 4));
+		}
+		entries.push({
+			hash: field(0),
+			path: str(field(1)),
+			filename: str(field(3)),
+			dirname: str(field(4)),
+			source: field(6) ? pack.slice(field(5), field(5) + field(6)) : null,
+			json: !!(field(7) & JSON_FLAG),
+			utf16: !!(field(7) & UTF16_FLAG),
+			wrapped: !!(field(7) & WRAPPED_FLAG),
+			dependencies: dependencies
+		});
+	}
+	return entries;
+}
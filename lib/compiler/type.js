@@ -897,12 +897,12 @@ Type.prototype.toNativeBody = function(varname, preamble, cleanup, declare) {
 		}
 		case NATIVE_STRING: {
 			var subvar = makeSafeVarname(varname);
-			preamble.push('auto '+subvar+'buf = HyperloopJSValueToStringCopy(ctx,'+varname+',exception);');
-			cleanup.push('delete [] '+subvar+'buf;');
+			// short strings are converted on the stack, long ones on the heap
+			preamble.push('Hyperloop::StringBuffer '+subvar+'buf(ctx,'+varname+',exception);');
 			if (this._length===1) {
 				return subvar+'buf[0]';
 			}
-			return subvar+'buf';
+			return subvar+'buf.data()';
 		}
 		case NATIVE_VOID:
 		case NATIVE_NULL: {
@@ -27,7 +27,10 @@ var defaultOptions = {
 	debug: false,
 	'log-level': 'info',
 	excludes: /^\.hyperloop$/,
-	obfuscate: true
+	obfuscate: true,
+	'module-wrapper': false,
+	'embed-format': 'base64',
+	'source-pack': false
 };
 switch (process.platform) {
 	case 'win32':
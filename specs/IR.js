@@ -354,6 +354,78 @@ describe("IR", function(){
 		code[11].should.be.equal('JSObjectSetProperty(ctx,object,var2,bounds,0,exception);');
 	});
 
+	it("should compile code nodes once as functions", function(){
+		jsgen.resetVariableNames();
+		var ir = new IR(),
+			source = 'function f() { var x = 2; return x; }\nCGPointMake_function(10,20);\nfor (var i = 0; i < 2; i++) { f(); }',
+			ast = Uglify.parse(source);
+		ir.parse({options:{},
+			symbols:{
+				'CGPointMake_function':{symbolname:'CGPointMake_function'}
+			}}, 'app.js', 'app.js', 'app.js', 'app.js', source, ast);
+		ir.count.should.be.equal(3);
+		var code = ir.toNative(),
+			program = JSON.parse(code[1].substring(3)),
+			calls = code.filter(function(line){ return /JSObjectCallAsFunction/.test(line); });
+		code[0].should.be.equal('// 2 code fragments compiled as functions');
+		// declarations become globals and each function starts on its line
+		var lines = program.split('\n');
+		lines.length.should.be.equal(3);
+		lines[0].should.be.equal('var f,i;[function() { f = function f() { var x = 2; return x; }; return f; },function() {');
+		lines[2].should.be.equal('    for (i = 0; i < 2; i++) { f(); } }]');
+		code.filter(function(line){ return /JSEvaluateScript/.test(line); }).length.should.be.equal(1);
+		calls.length.should.be.equal(2);
+		calls[0].should.be.equal('auto f = JSObjectCallAsFunction(ctx,var0[0],object,0,nullptr,exception);');
+		calls[1].should.be.equal('JSObjectCallAsFunction(ctx,var0[1],object,0,nullptr,exception);');
+		code.indexOf('JSObjectRef var0[2];').should.be.above(0);
+	});
+
+	it("should keep each line of a code fragment on its original line", function(){
+		jsgen.resetVariableNames();
+		var ir = new IR(),
+			source = 'var o = {\n\ta: 1,\n\tb: [\n\t\t2\n\t]\n};\nfor (var i = 0;\n\ti < 2;\n\ti++) {\n\to.a++;\n}',
+			ast = Uglify.parse(source);
+		ir.parse({options:{},symbols:{}}, 'app.js', 'app.js', 'app.js', 'app.js', source, ast);
+		ir.count.should.be.equal(1);
+		var program = JSON.parse(ir.toNative()[1].substring(3));
+		function lineOf(text) {
+			return program.substring(0, program.indexOf(text)).split('\n').length;
+		}
+		program.indexOf('var i;[function() { o = {').should.be.equal(0);
+		lineOf('a: 1').should.be.equal(2);
+		lineOf('b: [ 2 ] }; ').should.be.equal(3);
+		lineOf('for (i = 0; i < 2; i++) {').should.be.equal(7);
+		lineOf('o.a++; } }]').should.be.equal(10);
+	});
+
+	it("should share string and number literals in a constant pool", function(){
+		jsgen.resetVariableNames();
+		var constants = new IR.ConstantPool('HyperloopConstants_Source'),
+			ir = new IR(),
+			other = new IR();
+		ir.addVar('a', 'value', true);
+		ir.addVar('b', 1, true);
+		ir.addVar('c', true, true);
+		other.addVar('d', 'value', true);
+		var code = ir.toNative(null, constants);
+		code[0].should.be.equal('HyperloopConstants_Source_Initialize(ctx);');
+		code[2].should.be.equal('auto a = HyperloopConstants_Source[0]; // "value"');
+		code[9].should.be.equal('auto b = HyperloopConstants_Source[1]; // 1');
+		code[16].should.be.equal('auto c = JSValueMakeBoolean(ctx,true);');
+		code = other.toNative(null, constants);
+		code[2].should.be.equal('auto d = HyperloopConstants_Source[0]; // "value"');
+		constants.size.should.be.equal(2);
+		code = constants.toNative().split('\n');
+		code[0].should.be.equal('static JSValueRef HyperloopConstants_Source[2];');
+		code[2].should.be.equal('static void HyperloopConstants_Source_Initialize(JSContextRef ctx)');
+		code.indexOf('\t\tHyperloopConstants_Source[0] = JSValueMakeString(ctx,var4);').should.be.above(0);
+		code.indexOf('\t\tJSValueProtect(ctx,HyperloopConstants_Source[0]);').should.be.above(0);
+		code.indexOf('\t\tHyperloopConstants_Source[1] = JSValueMakeNumber(ctx,1);').should.be.above(0);
+		// without a pool literals are made where they are used
+		should(new IR().toNative().length).be.equal(0);
+		other.nodes[0].toNative().split('\n')[4].should.be.equal('auto d = JSValueMakeString(ctx,var7);');
+	});
+
 	it("should be able to parse native constructor", function(){
 		jsgen.resetVariableNames();
 		var ir = new IR(),
@@ -0,0 +1,112 @@
+var should = require('should'),
+	codegen = require('../').compiler.codegen;
+
+describe("build time require resolution", function() {
+
+	var files = {
+		'/app.js': {source:''},
+		'/lib/a.js': {source:''},
+		'/lib/b.json': {json:true, source:'{}'},
+		'/lib/c/index.js': {source:''},
+		'/lib/d': {source:''},
+		'/node_modules/foo/package.json': {json:true, source:'{"main":"lib/main.js"}'},
+		'/node_modules/foo/lib/main.js': {source:''},
+		'/node_modules/bar/index.js': {source:''}
+	};
+
+	it("should resolve files by extension", function(){
+		codegen.resolveRequire(files, '/lib', './a').should.be.equal('/lib/a.js');
+		codegen.resolveRequire(files, '/lib', './b').should.be.equal('/lib/b.json');
+		codegen.resolveRequire(files, '/lib', './d').should.be.equal('/lib/d');
+		codegen.resolveRequire(files, '/', '/lib/a.js').should.be.equal('/lib/a.js');
+		codegen.resolveRequire(files, '/lib/c', '../../app').should.be.equal('/app.js');
+	});
+
+	it("should resolve directories", function(){
+		codegen.resolveRequire(files, '/lib', './c').should.be.equal('/lib/c/index.js');
+		codegen.resolveRequire(files, '/', 'foo').should.be.equal('/node_modules/foo/lib/main.js');
+		codegen.resolveRequire(files, '/', 'bar').should.be.equal('/node_modules/bar/index.js');
+	});
+
+	it("should leave unresolved requests to the runtime", function(){
+		should.not.exist(codegen.resolveRequire(files, '/lib', './missing'));
+		// node_modules are searched from the module's directory down, like NodeModulesPaths
+		should.not.exist(codegen.resolveRequire(files, '/lib', 'foo'));
+	});
+
+	it("should report the paths probed in order", function(){
+		var probes = [];
+		codegen.resolveRequire(files, '/lib', './c', probes).should.be.equal('/lib/c/index.js');
+		probes.should.be.eql(['/lib/c', '/lib/c.js', '/lib/c.json', '/lib/c/package.json', '/lib/c/index.js']);
+	});
+
+	it("should find string literal requires", function(){
+		var source = [
+			'var a = require("a"), b = require(\'./b\');',
+			'require("a");',
+			'require(name);',
+			'require("c", 1);',
+			'other.require("d");',
+			'function f(require) { return require; }'
+		].join('\n');
+		codegen.findRequires(source).should.be.eql(['a', './b']);
+		codegen.findRequires('require("a"').should.be.eql([]);
+	});
+
+	it("should generate the require table", function(){
+		var filemap = [
+				{filename:'/app.js', dirname:'.', source:'require("./lib/a"); require("foo"); require("./missing"); require(name);'},
+				{filename:'/lib/a.js', dirname:'/lib', source:'require("../app"); require("./b"); require("./b");'},
+				{filename:'/lib/b.json', dirname:'/lib', json:true, source:'{}'},
+				{filename:'/node_modules/foo/package.json', dirname:'/node_modules/foo', json:true, source:'{"main":"lib/main.js"}'},
+				{filename:'/node_modules/foo/lib/main.js', dirname:'/node_modules/foo/lib', source:''}
+			],
+			table = codegen.generateRequireTable(filemap);
+		table.should.be.eql([
+			{dirname:'/', request:'./lib/a', path:'/lib/a.js'},
+			{dirname:'/', request:'foo', path:'/node_modules/foo/lib/main.js'},
+			{dirname:'/lib', request:'../app', path:'/app.js'},
+			{dirname:'/lib', request:'./b', path:'/lib/b.json'}
+		]);
+	});
+
+	it("should leave out requests another unit could answer first", function(){
+		// '/mod' and '/mod.js' are probed before '/mod/index.js' and are not
+		// under the module's own directory, so the app could embed them
+		var filemap = [
+				{filename:'/index.js', dirname:'/mod', source:''},
+				{filename:'/lib/a.js', dirname:'/mod/lib', source:'require(".."); require("./b");'},
+				{filename:'/lib/b.js', dirname:'/mod/lib', source:''}
+			],
+			table = codegen.generateRequireTable(filemap, 'mod');
+		table.should.be.eql([
+			{dirname:'/mod/lib', request:'./b', path:'/mod/lib/b.js'}
+		]);
+	});
+});
+
+describe("module evaluation", function() {
+
+	function generate(wrap) {
+		var code = [];
+		codegen.generateRequire({}, '\t', null, 'app', '/app.js', '/', [], [], [], 'var a = 1;', code, 'HL_app', null, false, wrap);
+		return code.join('\n');
+	}
+
+	it("should evaluate in the global scope without the module wrapper", function(){
+		var code = generate(false);
+		code.indexOf('JSEvaluateScript(ctx,').should.be.above(0);
+		code.indexOf('HyperloopEvaluateModule').should.be.equal(-1);
+		['module','exports','__filename','__dirname','require'].forEach(function(name){
+			code.indexOf('HyperloopWellKnownString(kHyperloopString_'+name+')').should.be.above(0);
+		});
+	});
+
+	it("should evaluate in a module wrapper", function(){
+		var code = generate(true);
+		code.indexOf('HyperloopEvaluateModule(ctx,module,').should.be.above(0);
+		code.indexOf('JSEvaluateScript').should.be.equal(-1);
+		code.indexOf('kHyperloopString_').should.be.equal(-1);
+		code.indexOf('result = HyperloopModuleLoaded(ctx,module);').should.be.above(0);
+	});
+});
@@ -1,5 +1,6 @@
 var should = require('should'),
-	jsgen = require('../').compiler.jsgen;
+	jsgen = require('../').compiler.jsgen,
+	lz4 = require('../').compiler.lz4;
 
 describe("JS source header generation", function() {
 
@@ -116,6 +117,49 @@ describe("JS source header generation", function() {
 		result.should.be.equal('#define HL_DECODE_foo(array,buf)\\\nfor (size_t i = 0; i < foo_length; i++) {\\\n\tbuf[i] = array[i] ^ _HL_XOR;\\\n}\n');
 	});
 
+	it('should compress with a header', function(){
+		var result = jsgen.compress('1+1');
+		result.should.not.be.null;
+		// marker, ASCII flag, length 3 and a block of 3 literals
+		result.source.should.be.equal("_(0xff), _(0x01), _(0x03), _(0x30), _(0x31), _(0x2b), _(0x31)");
+		result.length.should.be.equal(7);
+	});
+
+	it('should compress non ASCII sources with their UTF-8 length', function(){
+		var source = new Array(200).join('var s = "h\u00e9llo \ud83d\ude00";\n'),
+			result = jsgen.compress(source),
+			bytes = result.source.match(/0x[0-9a-f]+/g).map(function(value){ return parseInt(value,16); }),
+			utf8 = new Buffer(source.trim()),
+			length = (bytes[2] & 0x7f) | (bytes[3] << 7);
+		bytes.length.should.be.equal(result.length);
+		bytes[0].should.be.equal(0xff);
+		bytes[1].should.be.equal(0);
+		length.should.be.equal(utf8.length);
+		result.length.should.be.below(utf8.length / 4);
+		lz4.decompress(new Buffer(bytes.slice(4)), utf8.length).toString().should.be.equal(utf8.toString());
+	});
+
+	it('should round trip LZ4 blocks', function(){
+		var random = [];
+		for (var c = 0; c < 5000; c++) {
+			random.push((c * 7919) % 251);
+		}
+		['', 'a', 'abcdefghijklmnop', new Array(1000).join('a'), new Array(300).join('abcdefghijklmnopqrstuvwxyz'), random].forEach(function(input){
+			var buffer = new Buffer(input),
+				block = lz4.compress(buffer);
+			lz4.decompress(block, buffer.length).toString('hex').should.be.equal(buffer.toString('hex'));
+		});
+	});
+
+	it('should embed UTF-16 code units', function(){
+		var result = jsgen.characters('  x="\u00e9\ud83d\ude00";\n\n');
+		result.should.not.be.null;
+		result.source.should.be.equal("0x0078, 0x003d, 0x0022, 0x00e9, 0xd83d, 0xde00, 0x0022, 0x003b");
+		result.length.should.be.equal(8);
+		jsgen.generateDefine('foo',jsgen.characters('1'),'JSChar').should.be.equal("static const JSChar foo[] = {\n\t0x0031\n};\nstatic const size_t foo_length = 1;\n");
+		jsgen.encode('  1+1\n','utf16').toString('hex').should.be.equal('31002b003100');
+	});
+
 	it('should generate same obfuscation symbol', function(){
 		var uniq = ''+new Date;
 		jsgen.obfuscate(uniq).should.be.equal(jsgen.obfuscate(uniq));
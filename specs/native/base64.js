@@ -12,27 +12,18 @@ var should = require('should'),
 
 describe("base64", function(){
 
+	var build_dir = path.join(__dirname,'../../','build');
 
-	it("should be able to compile and test base64", function(done){
-		clang.should.not.be.null;
-
-		var build_dir = path.join(__dirname,'../../','build'),
-			config = {
+	/**
+	 * compile base64.cpp with main and link it into an executable named name
+	 */
+	function compileExecutable(name, main, callback) {
+		var config = {
 				srcfiles: [],
 				outdir: build_dir,
 				cflags: [ '-I"'+path.join(__dirname,'../../templates')+'"', '-DHL_TEST' ]
 			},
-			main = [
-				'#include <base64.h>',
-				'#include <string>',
-				'#include <iostream>',
-				'int main(int argc, char **argv){',
-				'\tstd::string str(argv[1]);',
-				'\tstd::cout << base64_decode(str) << std::endl;',
-				'\treturn 0;',
-				'}'
-			],
-			mainFile = path.join(build_dir,'main.cpp');
+			mainFile = path.join(build_dir,name+'_main.cpp');
 
 		if (!fs.existsSync(build_dir)) {
 			wrench.mkdirSyncRecursive(build_dir);
@@ -42,7 +33,7 @@ describe("base64", function(){
 
 		config.srcfiles.push({
 			srcfile: path.join(__dirname,'../../templates/base64.cpp'),
-			objfile: path.join(build_dir,'base64.o')
+			objfile: path.join(build_dir,name+'_base64.o')
 		});
 
 		config.srcfiles.push({
@@ -50,26 +41,188 @@ describe("base64", function(){
 			objfile: mainFile.replace(/\.cpp$/,'.o')
 		});
 
-
 		clang.compile(config, function(err, results) {
-			if (err) { return done(err); }
+			if (err) { return callback(err); }
 			results.length.should.be.equal(2);
 
-			var exe = path.join(build_dir, 'base64'),
+			var exe = path.join(build_dir, name),
 				cmd = 'clang '+results.join(' ')+' -o "'+exe+'" -lstdc++';
 
 			exec(cmd, function(err,stdout,stderr){
-				if (err) { return done (err); }
+				callback(err, exe);
+			});
+		});
+	}
+
+	it("should be able to compile and test base64", function(done){
+		clang.should.not.be.null;
+
+		var main = [
+				'#include <base64.h>',
+				'#include <string>',
+				'#include <iostream>',
+				'int main(int argc, char **argv){',
+				'\tstd::string str(argv[1]);',
+				'\tstd::cout << base64_decode(str) << std::endl;',
+				'\treturn 0;',
+				'}'
+			];
+
+		compileExecutable('base64', main, function(err, exe){
+			if (err) { return done(err); }
+
+			exec(exe+' aHlwZXJsb29w', function(err, stdout, stderr) {
+				if (err) { return done(err); }
+
+				stdout.trim().should.be.equal('hyperloop'); // aHlwZXJsb29w == hyperloop
+
+				done();
+			});
+		});
+
+	});
+
+	it("should decode into a caller supplied buffer", function(done){
+		var main = [
+				'#include <base64.h>',
+				'#include <string.h>',
+				'#include <stdio.h>',
+				'#include <stdlib.h>',
+				'int main(int argc, char **argv){',
+				'\tfor (int c = 1; c < argc; c++) {',
+				'\t\tsize_t length = strlen(argv[c]);',
+				'\t\tsize_t size = base64_decoded_length(argv[c], length);',
+				'\t\tunsigned char *buf = static_cast<unsigned char *>(malloc(size + 1));',
+				'\t\tsize_t written = base64_decode(argv[c], length, buf);',
+				'\t\tbuf[written] = 0;',
+				'\t\tprintf("%d:%d:%s\\n", (int)size, (int)written, buf);',
+				'\t\tfree(buf);',
+				'\t}',
+				'\treturn 0;',
+				'}'
+			],
+			// longer than a SIMD block so both the vector and scalar paths run
+			long = 'the quick brown fox jumps over the lazy dog, then does it again and again',
+			encoded = new Buffer(long).toString('base64');
+
+		compileExecutable('base64_buffer', main, function(err, exe){
+			if (err) { return done(err); }
+
+			exec(exe+' aGVsbG8= aGVsbG8h aGVsbA== aGV.sbG8h '+encoded, function(err, stdout, stderr) {
+				if (err) { return done(err); }
+
+				var lines = stdout.trim().split('\n');
+				lines.length.should.be.equal(5);
+				lines[0].should.be.equal('5:5:hello');
+				lines[1].should.be.equal('6:6:hello!');
+				lines[2].should.be.equal('4:4:hell');
+				lines[3].should.be.equal('6:2:he'); // stops at the first non base64 character
+				lines[4].should.be.equal(long.length+':'+long.length+':'+long);
+
+				done();
+			});
+		});
+	});
+
+	it("should decode obfuscated base64 UTF-8 into UTF-16", function(done){
+		var main = [
+				'#include <base64.h>',
+				'#include <string.h>',
+				'#include <stdio.h>',
+				'#include <stdlib.h>',
+				'int main(int argc, char **argv){',
+				'\tunsigned char key = static_cast<unsigned char>(strtol(argv[1], 0, 16));',
+				'\tfor (int c = 2; c < argc; c++) {',
+				'\t\tsize_t length = strlen(argv[c]);',
+				'\t\tfor (size_t i = 0; i < length; i++) {',
+				'\t\t\targv[c][i] ^= key;',
+				'\t\t}',
+				'\t\tunsigned short *buf = static_cast<unsigned short *>(malloc((length / 4 + 1) * 3 * sizeof(unsigned short)));',
+				'\t\tsize_t count = base64_decode_utf16(argv[c], length, key, buf);',
+				'\t\tfor (size_t i = 0; i < count; i++) {',
+				'\t\t\tprintf("%s%x", i ? " " : "", buf[i]);',
+				'\t\t}',
+				'\t\tprintf("\\n");',
+				'\t\tfree(buf);',
+				'\t}',
+				'\treturn 0;',
+				'}'
+			],
+			// multi-byte sequences and a surrogate pair, repeated so they cross the decode window
+			text = new Array(400).join('héllo € 😀 '),
+			expected = text.split('').map(function(ch){ return ch.charCodeAt(0).toString(16); }).join(' '),
+			encoded = new Buffer(text).toString('base64'),
+			// invalid UTF-8 (lone continuation byte and truncated sequence) becomes U+FFFD
+			invalid = new Buffer([0x61, 0x80, 0x62, 0xe2, 0x82]).toString('base64');
+
+		compileExecutable('base64_utf16', main, function(err, exe){
+			if (err) { return done(err); }
 
-				exec(exe+' aHlwZXJsb29w', function(err, stdout, stderr) {
-					if (err) { return done(err); }
+			exec(exe+' 20 '+encoded+' '+invalid, function(err, stdout, stderr) {
+				if (err) { return done(err); }
 
-					stdout.trim().should.be.equal('hyperloop'); // aHlwZXJsb29w == hyperloop
+				var lines = stdout.trim().split('\n');
+				lines.length.should.be.equal(2);
+				lines[0].should.be.equal(expected);
+				lines[1].should.be.equal('61 fffd 62 fffd');
 
-					done();
-				});
+				done();
 			});
 		});
+	});
+
+	it("should report base64 decode throughput", function(done){
+		this.timeout(120000);
+
+		var main = [
+				'#include <base64.h>',
+				'#include <string>',
+				'#include <chrono>',
+				'#include <stdio.h>',
+				'#include <stdlib.h>',
+				'static const char *alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";',
+				'int main(int argc, char **argv){',
+				'\tsize_t length = 4 * 1024 * 1024;',
+				'\tint iterations = 20;',
+				'\tstd::string encoded(length, \'A\');',
+				'\tfor (size_t i = 0; i < length; i++) {',
+				'\t\tencoded[i] = alphabet[(i * 7 + (i >> 5)) & 63];',
+				'\t}',
+				'\tsize_t size = base64_decoded_length(encoded.data(), length);',
+				'\tunsigned char *buf = static_cast<unsigned char *>(malloc(size));',
+				'\tsize_t total = 0;',
+				'\tauto start = std::chrono::high_resolution_clock::now();',
+				'\tfor (int i = 0; i < iterations; i++) {',
+				'\t\ttotal += base64_decode(encoded.data(), length, buf);',
+				'\t}',
+				'\tauto middle = std::chrono::high_resolution_clock::now();',
+				'\tfor (int i = 0; i < iterations; i++) {',
+				'\t\ttotal += base64_decode(encoded).size();',
+				'\t}',
+				'\tauto end = std::chrono::high_resolution_clock::now();',
+				'\tdouble mb = (double)length * iterations / (1024 * 1024);',
+				'\tdouble buffer = std::chrono::duration<double>(middle - start).count();',
+				'\tdouble string = std::chrono::duration<double>(end - middle).count();',
+				'\tprintf("%d %.1f %.1f\\n", (int)(total == size * iterations * 2), mb / buffer, mb / string);',
+				'\tfree(buf);',
+				'\treturn 0;',
+				'}'
+			];
+
+		compileExecutable('base64_bench', main, function(err, exe){
+			if (err) { return done(err); }
 
+			exec(exe, function(err, stdout, stderr) {
+				if (err) { return done(err); }
+
+				var result = stdout.trim().split(' ');
+				result[0].should.be.equal('1');
+				log.info('base64 decode throughput (MB/s): buffer='+result[1]+', std::string='+result[2]);
+				parseFloat(result[1]).should.be.above(0);
+				parseFloat(result[2]).should.be.above(0);
+
+				done();
+			});
+		});
 	});
 });
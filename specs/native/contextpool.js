@@ -0,0 +1,113 @@
+/**
+ * context pool specs
+ */
+
+var should = require('should'),
+	wrench = require('wrench'),
+	path = require('path'),
+	fs = require('fs'),
+	exec = require('child_process').exec,
+	clang = require('../../').compiler.clang;
+
+describe("contextpool", function(){
+
+	var build_dir = path.join(__dirname,'../../','build');
+
+	/**
+	 * compile main against the header only pool and link it into an executable named name
+	 */
+	function compileExecutable(name, main, callback) {
+		var config = {
+				srcfiles: [],
+				outdir: build_dir,
+				cflags: [ '-I"'+path.join(__dirname,'../../templates')+'"', '-DHL_TEST' ]
+			},
+			mainFile = path.join(build_dir,name+'_main.cpp');
+
+		if (!fs.existsSync(build_dir)) {
+			wrench.mkdirSyncRecursive(build_dir);
+		}
+
+		fs.writeFileSync(mainFile, main.join('\n'), 'utf8');
+
+		config.srcfiles.push({
+			srcfile: mainFile,
+			objfile: mainFile.replace(/\.cpp$/,'.o')
+		});
+
+		clang.compile(config, function(err, results) {
+			if (err) { return callback(err); }
+			results.length.should.be.equal(1);
+
+			var exe = path.join(build_dir, name),
+				cmd = 'clang '+results.join(' ')+' -o "'+exe+'" -lstdc++';
+
+			exec(cmd, function(err,stdout,stderr){
+				callback(err, exe);
+			});
+		});
+	}
+
+	it("should count created, reused and discarded contexts", function(done){
+		var main = [
+				'#include <contextpool.h>',
+				'#include <stdio.h>',
+				'static int next = 0;',
+				'static int create() { return ++next; }',
+				'static void report(Hyperloop::ContextPool<int> &pool) {',
+				'\tauto s = pool.stats();',
+				'\tprintf("%d %d %d %d %d %d %d\\n", (int)s.size, (int)s.available, (int)s.inUse, (int)s.highWater, (int)s.created, (int)s.reused, (int)s.discarded);',
+				'}',
+				'int main(int argc, char **argv){',
+				'\tHyperloop::ContextPool<int> pool(2);',
+				'\treport(pool);',
+				'\t// an empty pool is filled, the context handed out is a new one',
+				'\tauto a = pool.checkout(create);',
+				'\treport(pool);',
+				'\tauto b = pool.checkout(create);',
+				'\treport(pool);',
+				'\t// past the size, contexts are made on demand',
+				'\tauto c = pool.checkout(create);',
+				'\treport(pool);',
+				'\t// a is over the size and c is dirty, only b goes back',
+				'\tauto keptA = pool.checkin(a, true);',
+				'\tauto keptB = pool.checkin(b, true);',
+				'\tauto keptC = pool.checkin(c, false);',
+				'\tprintf("%d %d %d\\n", (int)keptA, (int)keptB, (int)keptC);',
+				'\treport(pool);',
+				'\tprintf("%d\\n", pool.checkout(create) == b);',
+				'\treport(pool);',
+				'\tauto excess = pool.resize(3, create);',
+				'\treport(pool);',
+				'\tprintf("%d %d\\n", (int)excess.size(), (int)pool.drain().size());',
+				'\treport(pool);',
+				'\treturn 0;',
+				'}'
+			];
+
+		compileExecutable('contextpool_stats', main, function(err, exe){
+			if (err) { return done(err); }
+
+			exec(exe, function(err, stdout, stderr) {
+				if (err) { return done(err); }
+
+				// size available inUse highWater created reused discarded
+				stdout.trim().split('\n').should.eql([
+					'2 0 0 0 0 0 0',
+					'2 1 1 1 2 0 0',
+					'2 0 2 2 2 1 0',
+					'2 0 3 3 3 1 0',
+					'0 1 0',
+					'2 1 0 3 3 1 2',
+					'1',
+					'2 0 1 3 3 2 2',
+					'3 2 1 3 5 2 2',
+					'0 2',
+					'3 0 1 3 5 2 2'
+				]);
+
+				done();
+			});
+		});
+	});
+});
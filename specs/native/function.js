@@ -0,0 +1,125 @@
+/**
+ * function object specs
+ */
+
+var should = require('should'),
+	wrench = require('wrench'),
+	path = require('path'),
+	fs = require('fs'),
+	exec = require('child_process').exec,
+	clang = require('../../').compiler.clang;
+
+describe("function objects", function(){
+
+	var build_dir = path.join(__dirname,'../../','build');
+
+	/**
+	 * compile main against JavaScriptCore and link it into an executable named name
+	 */
+	function compileExecutable(name, main, callback) {
+		var config = {
+				srcfiles: [],
+				outdir: build_dir,
+				cflags: [ '-I"'+path.join(__dirname,'../../templates')+'"', '-DHL_TEST' ]
+			},
+			mainFile = path.join(build_dir,name+'_main.cpp');
+
+		if (!fs.existsSync(build_dir)) {
+			wrench.mkdirSyncRecursive(build_dir);
+		}
+
+		fs.writeFileSync(mainFile, main.join('\n'), 'utf8');
+
+		config.srcfiles.push({
+			srcfile: mainFile,
+			objfile: mainFile.replace(/\.cpp$/,'.o')
+		});
+
+		clang.compile(config, function(err, results) {
+			if (err) { return callback(err); }
+			results.length.should.be.equal(1);
+
+			var exe = path.join(build_dir, name),
+				cmd = 'clang '+results.join(' ')+' -o "'+exe+'" -framework JavaScriptCore -lstdc++';
+
+			exec(cmd, function(err,stdout,stderr){
+				callback(err, exe);
+			});
+		});
+	}
+
+	// JavaScriptCore is only available to link against on OSX
+	(process.platform==='darwin' ? it : it.skip)("should call a bound require through call, apply and bind", function(done){
+		this.timeout(60000);
+
+		// the stand in require answers its private prefix and first argument,
+		// like the module require answers for the module it is bound to
+		var main = [
+				'#include <JavaScriptCore/JavaScriptCore.h>',
+				'#include <function.h>',
+				'#include <string>',
+				'#include <stdio.h>',
+				'static std::string toString(JSContextRef ctx, JSValueRef value) {',
+				'\tauto string = JSValueToStringCopy(ctx, value, nullptr);',
+				'\tstd::string result(JSStringGetMaximumUTF8CStringSize(string), 0);',
+				'\tresult.resize(JSStringGetUTF8CString(string, &result[0], result.size()) - 1);',
+				'\tJSStringRelease(string);',
+				'\treturn result;',
+				'}',
+				'static JSValueRef Require(JSContextRef ctx, JSObjectRef function, JSObjectRef object, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception) {',
+				'\tauto prefix = static_cast<const char *>(JSObjectGetPrivate(function));',
+				'\tauto request = prefix + toString(ctx, argumentCount ? arguments[0] : JSValueMakeUndefined(ctx));',
+				'\tauto string = JSStringCreateWithUTF8CString(request.c_str());',
+				'\tauto value = JSValueMakeString(ctx, string);',
+				'\tJSStringRelease(string);',
+				'\treturn value;',
+				'}',
+				'int main(int argc, char **argv){',
+				'\tJSClassDefinition def = kJSClassDefinitionEmpty;',
+				'\tdef.className = "require";',
+				'\tdef.callAsFunction = Require;',
+				'\tauto cls = JSClassCreate(&def);',
+				'\tauto ctx = JSGlobalContextCreate(nullptr);',
+				'\tauto functionName = JSStringCreateWithUTF8CString("Function");',
+				'\tauto prototypeName = JSStringCreateWithUTF8CString("prototype");',
+				'\tauto requireName = JSStringCreateWithUTF8CString("require");',
+				'\tstatic char prefix[] = "m:";',
+				'\tauto require = Hyperloop::MakeFunctionObject(ctx, cls, prefix, functionName, prototypeName);',
+				'\tJSObjectSetProperty(ctx, JSContextGetGlobalObject(ctx), requireName, require, 0, nullptr);',
+				'\tauto script = JSStringCreateWithUTF8CString(argv[1]);',
+				'\tJSValueRef exception = nullptr;',
+				'\tauto result = JSEvaluateScript(ctx, script, nullptr, nullptr, 0, &exception);',
+				'\tprintf("%s\\n", toString(ctx, exception ? exception : result).c_str());',
+				'\tJSStringRelease(script);',
+				'\tJSStringRelease(requireName);',
+				'\tJSStringRelease(prototypeName);',
+				'\tJSStringRelease(functionName);',
+				'\tJSGlobalContextRelease(ctx);',
+				'\tJSClassRelease(cls);',
+				'\treturn 0;',
+				'}'
+			],
+			script = [
+				'[',
+				'require("a"),',
+				'require.call(null, "b"),',
+				'require.apply(null, ["c"]),',
+				'require.bind(null, "d")(),',
+				'typeof require,',
+				'require instanceof Function',
+				'].join(" ")'
+			].join('');
+
+		compileExecutable('function_object', main, function(err, exe){
+			if (err) { return done(err); }
+
+			exec(exe+' \''+script+'\'', function(err, stdout, stderr) {
+				if (err) { return done(err); }
+
+				stdout.trim().should.be.equal('m:a m:b m:c m:d function true');
+
+				done();
+			});
+		});
+	});
+});
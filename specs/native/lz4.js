@@ -0,0 +1,299 @@
+/**
+ * lz4 specs
+ */
+
+var should = require('should'),
+	wrench = require('wrench'),
+	path = require('path'),
+	fs = require('fs'),
+	exec = require('child_process').exec,
+	clang = require('../../').compiler.clang,
+	jsgen = require('../../').compiler.jsgen,
+	log = require('../../').log;
+
+describe("lz4", function(){
+
+	var build_dir = path.join(__dirname,'../../','build'),
+		key = 0x20;
+
+	/**
+	 * compile lz4.cpp and base64.cpp with main and link it into an executable named name
+	 */
+	function compileExecutable(name, main, callback) {
+		var config = {
+				srcfiles: [],
+				outdir: build_dir,
+				cflags: [ '-I"'+path.join(__dirname,'../../templates')+'"', '-DHL_TEST' ]
+			},
+			mainFile = path.join(build_dir,name+'_main.cpp');
+
+		if (!fs.existsSync(build_dir)) {
+			wrench.mkdirSyncRecursive(build_dir);
+		}
+
+		fs.writeFileSync(mainFile, main.join('\n'), 'utf8');
+
+		['lz4','base64'].forEach(function(src){
+			config.srcfiles.push({
+				srcfile: path.join(__dirname,'../../templates/'+src+'.cpp'),
+				objfile: path.join(build_dir,name+'_'+src+'.o')
+			});
+		});
+
+		config.srcfiles.push({
+			srcfile: mainFile,
+			objfile: mainFile.replace(/\.cpp$/,'.o')
+		});
+
+		clang.compile(config, function(err, results) {
+			if (err) { return callback(err); }
+			results.length.should.be.equal(3);
+
+			var exe = path.join(build_dir, name),
+				cmd = 'clang '+results.join(' ')+' -o "'+exe+'" -lstdc++';
+
+			exec(cmd, function(err,stdout,stderr){
+				callback(err, exe);
+			});
+		});
+	}
+
+	/**
+	 * write the bytes the compiler embeds for source, obfuscated with key, to a file
+	 */
+	function writeEmbed(name, bytes) {
+		var fn = path.join(build_dir, name);
+		if (!fs.existsSync(build_dir)) {
+			wrench.mkdirSyncRecursive(build_dir);
+		}
+		fs.writeFileSync(fn, new Buffer(Array.prototype.map.call(bytes, function(b){ return b ^ key; })));
+		return fn;
+	}
+
+	function compressed(source) {
+		return jsgen.compress(source).source.match(/0x[0-9a-f]+/g).map(function(value){ return parseInt(value,16); });
+	}
+
+	var readFile = [
+			'static std::string readFile(const char *fn) {',
+			'\tstd::string data;',
+			'\tFILE *file = fopen(fn, "rb");',
+			'\tint ch;',
+			'\twhile ((ch = fgetc(file)) != EOF) {',
+			'\t\tdata.push_back(static_cast<char>(ch));',
+			'\t}',
+			'\tfclose(file);',
+			'\treturn data;',
+			'}'
+		];
+
+	it("should decompress embedded sources into UTF-16", function(done){
+		var main = [
+				'#include <lz4.h>',
+				'#include <string>',
+				'#include <stdio.h>',
+				'#include <stdlib.h>'
+			].concat(readFile).concat([
+				'int main(int argc, char **argv){',
+				'\tunsigned char key = static_cast<unsigned char>(strtol(argv[1], 0, 16));',
+				'\tfor (int c = 2; c < argc; c++) {',
+				'\t\tstd::string data = readFile(argv[c]);',
+				'\t\tif (!lz4_embed_compressed(data.data(), data.size(), key)) {',
+				'\t\t\tprintf("base64\\n");',
+				'\t\t\tcontinue;',
+				'\t\t}',
+				'\t\tsize_t size = lz4_embed_decoded_length(data.data(), data.size(), key);',
+				'\t\tunsigned short *buf = static_cast<unsigned short *>(malloc((size + 1) * sizeof(unsigned short)));',
+				'\t\tsize_t count = lz4_embed_decode_utf16(data.data(), data.size(), key, buf);',
+				'\t\tfor (size_t i = 0; i < count; i++) {',
+				'\t\t\tprintf("%s%x", i ? " " : "", buf[i]);',
+				'\t\t}',
+				'\t\tprintf("\\n");',
+				'\t\tfree(buf);',
+				'\t}',
+				'\treturn 0;',
+				'}'
+			]),
+			// long runs need extended literal and match lengths, the emoji a surrogate pair
+			sources = [
+				'x',
+				new Array(400).join('var a = require("./a");\n'),
+				new Array(100).join('héllo € 😀 '),
+				new Array(1000).join('a')
+			],
+			files = sources.map(function(source,i){
+				return writeEmbed('lz4_source'+i, compressed(source));
+			}),
+			expected = sources.map(function(source){
+				return source.trim().split('').map(function(ch){ return ch.charCodeAt(0).toString(16); }).join(' ');
+			});
+
+		files.push(writeEmbed('lz4_base64', new Buffer('aGVsbG8=')));
+
+		compileExecutable('lz4_utf16', main, function(err, exe){
+			if (err) { return done(err); }
+
+			exec(exe+' '+key.toString(16)+' '+files.join(' '), function(err, stdout, stderr) {
+				if (err) { return done(err); }
+
+				var lines = stdout.trim().split('\n');
+				lines.length.should.be.equal(sources.length+1);
+				expected.forEach(function(line,i){
+					lines[i].should.be.equal(line);
+				});
+				lines[sources.length].should.be.equal('base64');
+
+				done();
+			});
+		});
+	});
+
+	it("should report lz4 and base64 embed sizes and decode throughput", function(done){
+		this.timeout(120000);
+
+		var main = [
+				'#include <lz4.h>',
+				'#include <base64.h>',
+				'#include <string>',
+				'#include <chrono>',
+				'#include <stdio.h>',
+				'#include <stdlib.h>'
+			].concat(readFile).concat([
+				'int main(int argc, char **argv){',
+				'\tunsigned char key = static_cast<unsigned char>(strtol(argv[1], 0, 16));',
+				'\tstd::string compressed = readFile(argv[2]);',
+				'\tstd::string encoded = readFile(argv[3]);',
+				'\tint iterations = 200;',
+				'\tsize_t size = lz4_embed_decoded_length(compressed.data(), compressed.size(), key);',
+				'\tunsigned short *buf = static_cast<unsigned short *>(malloc(((encoded.size() / 4 + 1) * 3 + size) * sizeof(unsigned short)));',
+				'\tsize_t lz4 = 0, base64 = 0;',
+				'\tauto start = std::chrono::high_resolution_clock::now();',
+				'\tfor (int i = 0; i < iterations; i++) {',
+				'\t\tlz4 += lz4_embed_decode_utf16(compressed.data(), compressed.size(), key, buf);',
+				'\t}',
+				'\tauto middle = std::chrono::high_resolution_clock::now();',
+				'\tfor (int i = 0; i < iterations; i++) {',
+				'\t\tbase64 += base64_decode_utf16(encoded.data(), encoded.size(), key, buf);',
+				'\t}',
+				'\tauto end = std::chrono::high_resolution_clock::now();',
+				'\tdouble mb = (double)lz4 / (1024 * 1024);',
+				'\tprintf("%d %.1f %.1f\\n", (int)(lz4 == base64), mb / std::chrono::duration<double>(middle - start).count(), mb / std::chrono::duration<double>(end - middle).count());',
+				'\tfree(buf);',
+				'\treturn 0;',
+				'}'
+			]),
+			// the compiler itself stands in for a typical app source
+			source = fs.readFileSync(path.join(__dirname,'../../lib/compiler/codegen.js'),'utf8'),
+			lines = source.split('\n').map(function(line){ return line.trim(); }).filter(Boolean),
+			lz4 = compressed(source),
+			base64 = new Buffer(new Buffer(lines.join('\n')).toString('base64')),
+			files = [
+				writeEmbed('lz4_bench_lz4', lz4),
+				writeEmbed('lz4_bench_base64', base64)
+			];
+
+		lz4.length.should.be.below(base64.length);
+
+		compileExecutable('lz4_bench', main, function(err, exe){
+			if (err) { return done(err); }
+
+			exec(exe+' '+key.toString(16)+' '+files.join(' '), function(err, stdout, stderr) {
+				if (err) { return done(err); }
+
+				var result = stdout.trim().split(' ');
+				result[0].should.be.equal('1');
+				log.info('embedded source bytes: lz4='+lz4.length+', base64='+base64.length);
+				log.info('embed decode throughput (MB/s): lz4='+result[1]+', base64='+result[2]);
+				parseFloat(result[1]).should.be.above(0);
+				parseFloat(result[2]).should.be.above(0);
+
+				done();
+			});
+		});
+	});
+
+	it("should report the cold load cost of each embed format", function(done){
+		this.timeout(120000);
+
+		// every load reads its own copy of the embedded bytes so none is in cache,
+		// then does what HyperloopDecodeEmbedString or HyperloopCreateEmbedString
+		// does before JavaScriptCore gets the string, with a copy standing in for
+		// JSStringCreateWithCharacters
+		var main = [
+				'#include <lz4.h>',
+				'#include <base64.h>',
+				'#include <string>',
+				'#include <vector>',
+				'#include <chrono>',
+				'#include <string.h>',
+				'#include <stdio.h>',
+				'#include <stdlib.h>'
+			].concat(readFile).concat([
+				'static unsigned short *create(const unsigned short *characters, size_t length) {',
+				'\tauto string = new unsigned short[length];',
+				'\tmemcpy(string, characters, length * sizeof(unsigned short));',
+				'\treturn string;',
+				'}',
+				'template <typename F> static double load(const std::string &embed, int copies, F decode) {',
+				'\tstd::vector<std::string> data(copies, embed);',
+				'\tsize_t total = 0;',
+				'\tauto start = std::chrono::high_resolution_clock::now();',
+				'\tfor (auto &d : data) {',
+				'\t\tauto string = decode(d);',
+				'\t\ttotal += string[0];',
+				'\t\tdelete [] string;',
+				'\t}',
+				'\tauto end = std::chrono::high_resolution_clock::now();',
+				'\treturn total ? std::chrono::duration<double, std::micro>(end - start).count() / copies : 0;',
+				'}',
+				'int main(int argc, char **argv){',
+				'\tunsigned char key = static_cast<unsigned char>(strtol(argv[1], 0, 16));',
+				'\tstd::string compressed = readFile(argv[2]);',
+				'\tstd::string encoded = readFile(argv[3]);',
+				'\tstd::string characters = readFile(argv[4]);',
+				'\tint copies = 512;',
+				'\tauto decoded = [key](const std::string &d, bool lz4) {',
+				'\t\tauto size = lz4 ? lz4_embed_decoded_length(d.data(), d.size(), key) + 1 : (d.size() / 4 + 1) * 3;',
+				'\t\tauto buf = new unsigned short[size];',
+				'\t\tauto count = lz4 ? lz4_embed_decode_utf16(d.data(), d.size(), key, buf) : base64_decode_utf16(d.data(), d.size(), key, buf);',
+				'\t\tauto string = create(buf, count);',
+				'\t\tmemset(buf, 0, size * sizeof(unsigned short));',
+				'\t\tdelete [] buf;',
+				'\t\treturn string;',
+				'\t};',
+				'\tdouble lz4 = load(compressed, copies, [&](const std::string &d) { return decoded(d, true); });',
+				'\tdouble base64 = load(encoded, copies, [&](const std::string &d) { return decoded(d, false); });',
+				'\tdouble utf16 = load(characters, copies, [](const std::string &d) {',
+				'\t\treturn create(reinterpret_cast<const unsigned short *>(d.data()), d.size() / sizeof(unsigned short));',
+				'\t});',
+				'\tprintf("%d %.1f %.1f %.1f\\n", (int)(lz4 > 0 && base64 > 0 && utf16 > 0), lz4, base64, utf16);',
+				'\treturn 0;',
+				'}'
+			]),
+			source = fs.readFileSync(path.join(__dirname,'../../lib/compiler/codegen.js'),'utf8'),
+			lines = source.split('\n').map(function(line){ return line.trim(); }).filter(Boolean),
+			characters = path.join(build_dir,'lz4_cold_utf16'),
+			files = [
+				writeEmbed('lz4_cold_lz4', compressed(source)),
+				writeEmbed('lz4_cold_base64', new Buffer(new Buffer(lines.join('\n')).toString('base64'))),
+				characters
+			];
+
+		// UTF-16 is embedded as is
+		fs.writeFileSync(characters, jsgen.encode(source,'utf16'));
+
+		compileExecutable('lz4_cold', main, function(err, exe){
+			if (err) { return done(err); }
+
+			exec(exe+' '+key.toString(16)+' '+files.join(' '), function(err, stdout, stderr) {
+				if (err) { return done(err); }
+
+				var result = stdout.trim().split(' ');
+				result[0].should.be.equal('1');
+				log.info('cold embed load (us/module): lz4='+result[1]+', base64='+result[2]+', utf16='+result[3]+' (none with HL_STRING_NOCOPY)');
+
+				done();
+			});
+		});
+	});
+});
@@ -0,0 +1,182 @@
+/**
+ * native object pool specs
+ */
+
+var should = require('should'),
+	wrench = require('wrench'),
+	path = require('path'),
+	fs = require('fs'),
+	exec = require('child_process').exec,
+	clang = require('../../').compiler.clang;
+
+describe("objectpool", function(){
+
+	var build_dir = path.join(__dirname,'../../','build'),
+		sizes = [16, 32, 48, 64, 96, 128];
+
+	/**
+	 * compile main against the header only pool and link it into an executable named name
+	 */
+	function compileExecutable(name, main, callback) {
+		var config = {
+				srcfiles: [],
+				outdir: build_dir,
+				cflags: [ '-I"'+path.join(__dirname,'../../templates')+'"', '-DHL_TEST' ]
+			},
+			mainFile = path.join(build_dir,name+'_main.cpp');
+
+		if (!fs.existsSync(build_dir)) {
+			wrench.mkdirSyncRecursive(build_dir);
+		}
+
+		fs.writeFileSync(mainFile, main.join('\n'), 'utf8');
+
+		config.srcfiles.push({
+			srcfile: mainFile,
+			objfile: mainFile.replace(/\.cpp$/,'.o')
+		});
+
+		clang.compile(config, function(err, results) {
+			if (err) { return callback(err); }
+			results.length.should.be.equal(1);
+
+			var exe = path.join(build_dir, name),
+				cmd = 'clang '+results.join(' ')+' -o "'+exe+'" -lstdc++';
+
+			exec(cmd, function(err,stdout,stderr){
+				callback(err, exe);
+			});
+		});
+	}
+
+	it("should reuse freed blocks", function(done){
+		var main = [
+				'#include <_objectpool.h>',
+				'#include <stdio.h>',
+				'template <size_t Size>',
+				'void check() {',
+				'\tvoid *first = Hyperloop::ObjectPool<Size>::allocate();',
+				'\tHyperloop::ObjectPool<Size>::deallocate(first);',
+				'\tvoid *second = Hyperloop::ObjectPool<Size>::allocate();',
+				'\tHyperloop::ObjectPool<Size>::deallocate(second);',
+				'\tvoid *third = Hyperloop::PoolAllocate(Size - 1);',
+				'\tHyperloop::PoolDeallocate(third, Size - 1);',
+				'\tprintf("%d %d %d\\n", (int)Size, (int)(first == second), (int)(second == third));',
+				'}',
+				'int main(int argc, char **argv){',
+				'\tcheck<16>(); check<32>(); check<48>(); check<64>(); check<96>(); check<128>();',
+				'\treturn 0;',
+				'}'
+			];
+
+		compileExecutable('objectpool_reuse', main, function(err, exe){
+			if (err) { return done(err); }
+
+			exec(exe, function(err, stdout, stderr) {
+				if (err) { return done(err); }
+
+				var lines = stdout.trim().split('\n');
+				lines.length.should.be.equal(sizes.length);
+				sizes.forEach(function(size,i){
+					lines[i].should.be.equal(size+' 1 1');
+				});
+
+				done();
+			});
+		});
+	});
+
+	it("should align blocks in every size class", function(done){
+		var main = [
+				'#include <_objectpool.h>',
+				'#include <stdint.h>',
+				'#include <stdio.h>',
+				'#include <set>',
+				'template <size_t Size>',
+				'void check() {',
+				'\t// allocate past the first slab so blocks from two slabs are checked',
+				'\tconst size_t count = Hyperloop::ObjectPool<Size>::SlabBlocks * 2 + 1;',
+				'\tvoid *blocks[count];',
+				'\tstd::set<uintptr_t> addresses;',
+				'\tint aligned = 1, disjoint = 1;',
+				'\tfor (size_t c = 0; c < count; c++) {',
+				'\t\tblocks[c] = Hyperloop::PoolAllocate(Size);',
+				'\t\tauto address = reinterpret_cast<uintptr_t>(blocks[c]);',
+				'\t\tif (address % alignof(std::max_align_t) != 0) aligned = 0;',
+				'\t\taddresses.insert(address);',
+				'\t}',
+				'\tuintptr_t previous = 0;',
+				'\tfor (auto address : addresses) {',
+				'\t\tif (previous != 0 && address - previous < Size) disjoint = 0;',
+				'\t\tprevious = address;',
+				'\t}',
+				'\tfor (size_t c = 0; c < count; c++) {',
+				'\t\tHyperloop::PoolDeallocate(blocks[c], Size);',
+				'\t}',
+				'\tprintf("%d %d %d %d\\n", (int)Size, aligned, disjoint, (int)(addresses.size() == count));',
+				'}',
+				'int main(int argc, char **argv){',
+				'\tcheck<16>(); check<32>(); check<48>(); check<64>(); check<96>(); check<128>();',
+				'\treturn 0;',
+				'}'
+			];
+
+		compileExecutable('objectpool_align', main, function(err, exe){
+			if (err) { return done(err); }
+
+			exec(exe, function(err, stdout, stderr) {
+				if (err) { return done(err); }
+
+				var lines = stdout.trim().split('\n');
+				lines.length.should.be.equal(sizes.length);
+				sizes.forEach(function(size,i){
+					lines[i].should.be.equal(size+' 1 1 1');
+				});
+
+				done();
+			});
+		});
+	});
+
+	it("should report live and cached blocks", function(done){
+		var main = [
+				'#include <_objectpool.h>',
+				'#include <stdio.h>',
+				'void report() {',
+				'\tsize_t live, cached;',
+				'\tHyperloop::NativeObjectPoolStats(live, cached);',
+				'\tprintf("%d %d\\n", (int)live, (int)cached);',
+				'}',
+				'int main(int argc, char **argv){',
+				'\treport();',
+				'\tvoid *small = Hyperloop::PoolAllocate(8);',
+				'\tvoid *medium = Hyperloop::PoolAllocate(100);',
+				'\tvoid *large = Hyperloop::PoolAllocate(1000);',
+				'\treport();',
+				'\tHyperloop::PoolDeallocate(small, 8);',
+				'\tHyperloop::PoolDeallocate(medium, 100);',
+				'\tHyperloop::PoolDeallocate(large, 1000);',
+				'\treport();',
+				'\treturn 0;',
+				'}'
+			];
+
+		compileExecutable('objectpool_stats', main, function(err, exe){
+			if (err) { return done(err); }
+
+			exec(exe, function(err, stdout, stderr) {
+				if (err) { return done(err); }
+
+				// each size class carves a whole slab on first use; the large
+				// block comes from the global heap and is not counted
+				var lines = stdout.trim().split('\n');
+				lines.length.should.be.equal(3);
+				lines[0].should.be.equal('0 0');
+				lines[1].should.be.equal('2 126');
+				lines[2].should.be.equal('0 128');
+
+				done();
+			});
+		});
+	});
+});
@@ -0,0 +1,182 @@
+/**
+ * require path engine specs
+ */
+
+var should = require('should'),
+	wrench = require('wrench'),
+	path = require('path'),
+	fs = require('fs'),
+	exec = require('child_process').exec,
+	clang = require('../../').compiler.clang,
+	log = require('../../').log;
+
+describe("path", function(){
+
+	var build_dir = path.join(__dirname,'../../','build');
+
+	/**
+	 * compile path.cpp with main and link it into an executable named name
+	 */
+	function compileExecutable(name, main, callback) {
+		var config = {
+				srcfiles: [],
+				outdir: build_dir,
+				cflags: [ '-I"'+path.join(__dirname,'../../templates')+'"', '-DHL_TEST' ]
+			},
+			mainFile = path.join(build_dir,name+'_main.cpp');
+
+		if (!fs.existsSync(build_dir)) {
+			wrench.mkdirSyncRecursive(build_dir);
+		}
+
+		fs.writeFileSync(mainFile, main.join('\n'), 'utf8');
+
+		config.srcfiles.push({
+			srcfile: path.join(__dirname,'../../templates/path.cpp'),
+			objfile: path.join(build_dir,name+'_path.o')
+		});
+
+		config.srcfiles.push({
+			srcfile: mainFile,
+			objfile: mainFile.replace(/\.cpp$/,'.o')
+		});
+
+		clang.compile(config, function(err, results) {
+			if (err) { return callback(err); }
+			results.length.should.be.equal(2);
+
+			var exe = path.join(build_dir, name),
+				cmd = 'clang '+results.join(' ')+' -o "'+exe+'" -lstdc++';
+
+			exec(cmd, function(err,stdout,stderr){
+				callback(err, exe);
+			});
+		});
+	}
+
+	it("should resolve paths like path.resolve", function(done){
+		var main = [
+				'#include <path.h>',
+				'#include <stdio.h>',
+				'int main(int argc, char **argv){',
+				'\tHyperloop::PathBuffer out;',
+				'\tfor (int c = 1; c + 1 < argc; c += 2) {',
+				'\t\tHyperloop::PathResolve(argv[c], argv[c + 1], out);',
+				'\t\tprintf("%s\\n", out.c_str());',
+				'\t}',
+				'\treturn 0;',
+				'}'
+			],
+			dirs = ['/', '/a', '/a/b/', '/a//b', '/a/./b/..', '/node_modules/foo/lib', '.', ''],
+			requests = ['x', './x', '../x', '../../../../x', './a/../b/./c', '/abs', '/abs/../y', '.', '..', './', '../',
+				'x//y/', 'foo/bar.js', '...', '.hidden/./x', new Array(80).join('seg/')],
+			cases = [];
+
+		dirs.forEach(function(dir){
+			requests.forEach(function(request){
+				cases.push([dir,request]);
+			});
+		});
+
+		compileExecutable('path_resolve', main, function(err, exe){
+			if (err) { return done(err); }
+
+			var args = cases.map(function(c){ return '"'+c[0]+'" "'+c[1]+'"'; }).join(' ');
+			exec(exe+' '+args, function(err, stdout, stderr) {
+				if (err) { return done(err); }
+
+				var lines = stdout.trim().split('\n');
+				lines.length.should.be.equal(cases.length);
+				cases.forEach(function(c,i){
+					lines[i].should.be.equal((path.posix || path).resolve('/',c[0],c[1]));
+				});
+
+				done();
+			});
+		});
+	});
+
+	it("should generate node_modules directories from the root down", function(done){
+		var main = [
+				'#include <path.h>',
+				'#include <stdio.h>',
+				'int main(int argc, char **argv){',
+				'\tHyperloop::PathBuffer out;',
+				'\tfor (int c = 1; c < argc; c++) {',
+				'\t\tHyperloop::NodeModulesPaths paths(argv[c]);',
+				'\t\twhile (paths.next(out)) {',
+				'\t\t\tprintf("%s ", out.c_str());',
+				'\t\t}',
+				'\t\tprintf("\\n");',
+				'\t}',
+				'\treturn 0;',
+				'}'
+			];
+
+		compileExecutable('path_node_modules', main, function(err, exe){
+			if (err) { return done(err); }
+
+			exec(exe+' / /a /a/b/c /a/./b/../c/', function(err, stdout, stderr) {
+				if (err) { return done(err); }
+
+				var lines = stdout.split('\n');
+				lines[0].trim().should.be.equal('/node_modules');
+				lines[1].trim().should.be.equal('/a/node_modules');
+				lines[2].trim().should.be.equal('/a/node_modules /a/b/node_modules /a/b/c/node_modules');
+				lines[3].trim().should.be.equal('/a/node_modules /a/c/node_modules');
+
+				done();
+			});
+		});
+	});
+
+	it("should report path resolve throughput", function(done){
+		this.timeout(120000);
+
+		var main = [
+				'#include <path.h>',
+				'#include <chrono>',
+				'#include <stdio.h>',
+				'int main(int argc, char **argv){',
+				'\tint iterations = 1000000;',
+				'\tHyperloop::PathBuffer out;',
+				'\tHyperloop::PathBuffer directory;',
+				'\tsize_t total = 0;',
+				'\tauto start = std::chrono::high_resolution_clock::now();',
+				'\tfor (int i = 0; i < iterations; i++) {',
+				'\t\tHyperloop::PathResolve("/app/lib/controllers/../views", "../../node_modules/foo/./lib/index.js", out);',
+				'\t\ttotal += out.size();',
+				'\t}',
+				'\tauto middle = std::chrono::high_resolution_clock::now();',
+				'\tfor (int i = 0; i < iterations; i++) {',
+				'\t\tHyperloop::NodeModulesPaths paths("/app/lib/controllers/views");',
+				'\t\twhile (paths.next(directory)) {',
+				'\t\t\tHyperloop::PathResolve(directory.view(), "foo", out);',
+				'\t\t\ttotal += out.size();',
+				'\t\t}',
+				'\t}',
+				'\tauto end = std::chrono::high_resolution_clock::now();',
+				'\tdouble resolve = std::chrono::duration<double>(middle - start).count();',
+				'\tdouble ancestors = std::chrono::duration<double>(end - middle).count();',
+				'\tprintf("%d %.1f %.1f\\n", (int)(total > 0), resolve * 1e9 / iterations, ancestors * 1e9 / iterations);',
+				'\treturn 0;',
+				'}'
+			];
+
+		compileExecutable('path_bench', main, function(err, exe){
+			if (err) { return done(err); }
+
+			exec(exe, function(err, stdout, stderr) {
+				if (err) { return done(err); }
+
+				var result = stdout.trim().split(' ');
+				result[0].should.be.equal('1');
+				log.info('path engine (ns/op): resolve='+result[1]+', node_modules walk='+result[2]);
+				parseFloat(result[1]).should.be.above(0);
+				parseFloat(result[2]).should.be.above(0);
+
+				done();
+			});
+		});
+	});
+});
@@ -0,0 +1,257 @@
+/**
+ * prefetch specs
+ */
+
+var should = require('should'),
+	wrench = require('wrench'),
+	path = require('path'),
+	fs = require('fs'),
+	exec = require('child_process').exec,
+	clang = require('../../').compiler.clang,
+	jsgen = require('../../').compiler.jsgen;
+
+describe("prefetch", function(){
+
+	var build_dir = path.join(__dirname,'../../','build'),
+		include_dir = path.join(build_dir,'prefetch_include'),
+		key = 0x20;
+
+	/**
+	 * stands in for hyperloop.h: a JSStringRef that is a plain UTF-16 buffer,
+	 * so prefetch.cpp builds without JavaScriptCore
+	 */
+	var header = [
+			'#ifndef __HYPERLOOP_HEADER__',
+			'#define __HYPERLOOP_HEADER__',
+			'#include <string>',
+			'#include <vector>',
+			'#include <stddef.h>',
+			'#define EXPORTAPI extern "C"',
+			'#define HL_PREFETCH 1',
+			'struct OpaqueJSString { std::vector<unsigned short> characters; };',
+			'typedef OpaqueJSString* JSStringRef;',
+			'struct HyperloopPrefetchEntry',
+			'{',
+			'\tconst char *path;',
+			'\tconst char *encoded;',
+			'\tsize_t length;',
+			'\tconst size_t *dependencies;',
+			'\tsize_t dependencyCount;',
+			'};',
+			'EXPORTAPI void JSStringRelease(JSStringRef string);',
+			'EXPORTAPI JSStringRef HyperloopDecodeEmbedString(const char *encoded, size_t length, unsigned char key);',
+			'EXPORTAPI bool HyperloopRegisterPrefetchGraph(const HyperloopPrefetchEntry *entries, size_t count, unsigned char key);',
+			'EXPORTAPI void HyperloopPrefetchStart(const char *path);',
+			'EXPORTAPI void HyperloopPrefetchStop();',
+			'EXPORTAPI JSStringRef HyperloopTakeEmbedString(const char *encoded, size_t length, unsigned char key);',
+			'EXPORTAPI void HyperloopPrefetchStats(size_t *prefetched, size_t *decoded, size_t *ready);',
+			'#endif'
+		];
+
+	/**
+	 * compile prefetch.cpp, lz4.cpp and base64.cpp with main against the stand in
+	 * header and link it into an executable named name
+	 */
+	function compileExecutable(name, main, callback) {
+		var config = {
+				srcfiles: [],
+				outdir: build_dir,
+				cflags: [ '-I"'+include_dir+'"', '-I"'+path.join(__dirname,'../../templates')+'"', '-DHL_TEST' ]
+			},
+			mainFile = path.join(build_dir,name+'_main.cpp');
+
+		if (!fs.existsSync(include_dir)) {
+			wrench.mkdirSyncRecursive(include_dir);
+		}
+
+		fs.writeFileSync(path.join(include_dir,'hyperloop.h'), header.join('\n'), 'utf8');
+		fs.writeFileSync(mainFile, main.join('\n'), 'utf8');
+
+		['prefetch','lz4','base64'].forEach(function(src){
+			config.srcfiles.push({
+				srcfile: path.join(__dirname,'../../templates/'+src+'.cpp'),
+				objfile: path.join(build_dir,name+'_'+src+'.o')
+			});
+		});
+
+		config.srcfiles.push({
+			srcfile: mainFile,
+			objfile: mainFile.replace(/\.cpp$/,'.o')
+		});
+
+		clang.compile(config, function(err, results) {
+			if (err) { return callback(err); }
+			results.length.should.be.equal(4);
+
+			var exe = path.join(build_dir, name),
+				cmd = 'clang '+results.join(' ')+' -o "'+exe+'" -lstdc++ -lpthread';
+
+			exec(cmd, function(err,stdout,stderr){
+				callback(err, exe);
+			});
+		});
+	}
+
+	/**
+	 * write the bytes the compiler embeds for source, obfuscated with key, to a file
+	 */
+	function writeEmbed(name, bytes) {
+		var fn = path.join(build_dir, name);
+		if (!fs.existsSync(build_dir)) {
+			wrench.mkdirSyncRecursive(build_dir);
+		}
+		fs.writeFileSync(fn, new Buffer(Array.prototype.map.call(bytes, function(b){ return b ^ key; })));
+		return fn;
+	}
+
+	it("should decode a require graph on worker threads", function(done){
+		this.timeout(120000);
+
+		// source i requires 2i+1 and 2i+2. the workers sleep a little per source
+		// so the JS thread catches up with them and has to wait or decode itself
+		var main = [
+				'#include <hyperloop.h>',
+				'#include <lz4.h>',
+				'#include <base64.h>',
+				'#include <atomic>',
+				'#include <chrono>',
+				'#include <thread>',
+				'#include <stdio.h>',
+				'#include <stdlib.h>',
+				'static std::atomic<int> live(0);',
+				'static std::thread::id mainThread;',
+				'EXPORTAPI void JSStringRelease(JSStringRef string) {',
+				'\tlive--;',
+				'\tdelete string;',
+				'}',
+				'EXPORTAPI JSStringRef HyperloopDecodeEmbedString(const char *encoded, size_t length, unsigned char key) {',
+				'\tif (std::this_thread::get_id() != mainThread) {',
+				'\t\tstd::this_thread::sleep_for(std::chrono::microseconds(500));',
+				'\t}',
+				'\tauto string = new OpaqueJSString;',
+				'\tauto &chars = string->characters;',
+				'\tif (lz4_embed_compressed(encoded, length, key)) {',
+				'\t\tchars.resize(lz4_embed_decoded_length(encoded, length, key) + 1);',
+				'\t\tchars.resize(lz4_embed_decode_utf16(encoded, length, key, chars.data()));',
+				'\t}',
+				'\telse {',
+				'\t\tchars.resize((length / 4 + 1) * 3);',
+				'\t\tchars.resize(base64_decode_utf16(encoded, length, key, chars.data()));',
+				'\t}',
+				'\tlive++;',
+				'\treturn string;',
+				'}',
+				'static std::string readFile(const char *fn) {',
+				'\tstd::string data;',
+				'\tFILE *file = fopen(fn, "rb");',
+				'\tint ch;',
+				'\twhile ((ch = fgetc(file)) != EOF) {',
+				'\t\tdata.push_back(static_cast<char>(ch));',
+				'\t}',
+				'\tfclose(file);',
+				'\treturn data;',
+				'}',
+				'static std::vector<std::string> sources;',
+				'static unsigned char key;',
+				'// take source i and compare it with decoding it directly',
+				'static int take(const std::string &source) {',
+				'\tauto taken = HyperloopTakeEmbedString(source.data(), source.size(), key);',
+				'\tauto expected = HyperloopDecodeEmbedString(source.data(), source.size(), key);',
+				'\tint same = taken->characters == expected->characters && !expected->characters.empty();',
+				'\tJSStringRelease(taken);',
+				'\tJSStringRelease(expected);',
+				'\treturn same;',
+				'}',
+				'static void stats(size_t &prefetched, size_t &decoded, size_t &ready) {',
+				'\tHyperloopPrefetchStats(&prefetched, &decoded, &ready);',
+				'}',
+				'int main(int argc, char **argv){',
+				'\tmainThread = std::this_thread::get_id();',
+				'\tkey = static_cast<unsigned char>(strtol(argv[1], 0, 16));',
+				'\tsize_t count = argc - 2;',
+				'\tstd::vector<std::string> paths;',
+				'\tstd::vector<std::vector<size_t>> dependencies(count);',
+				'\tstd::vector<HyperloopPrefetchEntry> entries;',
+				'\tfor (size_t c = 0; c < count; c++) {',
+				'\t\tsources.push_back(readFile(argv[c + 2]));',
+				'\t\tpaths.push_back("/m" + std::to_string(c) + ".js");',
+				'\t\tfor (size_t d = 2 * c + 1; d <= 2 * c + 2 && d < count; d++) {',
+				'\t\t\tdependencies[c].push_back(d);',
+				'\t\t}',
+				'\t}',
+				'\tfor (size_t c = 0; c < count; c++) {',
+				'\t\tentries.push_back(HyperloopPrefetchEntry{paths[c].c_str(), sources[c].data(), sources[c].size(), dependencies[c].data(), dependencies[c].size()});',
+				'\t}',
+				'\tHyperloopRegisterPrefetchGraph(entries.data(), count, key);',
+				'\tsize_t prefetched, decoded, ready, lastPrefetched, lastDecoded;',
+				'\t// let the workers finish, everything is then handed over ready',
+				'\tHyperloopPrefetchStart("/m0.js");',
+				'\tfor (int wait = 0; wait < 10000; wait++) {',
+				'\t\tstats(prefetched, decoded, ready);',
+				'\t\tif (ready == count) break;',
+				'\t\tstd::this_thread::sleep_for(std::chrono::milliseconds(1));',
+				'\t}',
+				'\tint same = 1;',
+				'\tfor (size_t c = 0; c < count; c++) same &= take(sources[c]);',
+				'\tstats(prefetched, decoded, ready);',
+				'\tprintf("%d %d %d %d\\n", same, (int)prefetched, (int)decoded, (int)ready);',
+				'\t// take in graph order right away, racing the workers',
+				'\tHyperloopPrefetchStop();',
+				'\tHyperloopPrefetchStart("/m0.js");',
+				'\tsame = 1;',
+				'\tfor (size_t c = 0; c < count; c++) same &= take(sources[c]);',
+				'\tlastPrefetched = prefetched;',
+				'\tlastDecoded = decoded;',
+				'\tstats(prefetched, decoded, ready);',
+				'\tprintf("%d %d %d\\n", same, (int)(prefetched - lastPrefetched + decoded - lastDecoded), (int)ready);',
+				'\t// a source taken already and one outside the graph are decoded on the spot',
+				'\tstd::string copy = sources[0];',
+				'\tsame = take(sources[0]) & take(copy);',
+				'\tlastPrefetched = prefetched;',
+				'\tlastDecoded = decoded;',
+				'\tstats(prefetched, decoded, ready);',
+				'\tprintf("%d %d %d\\n", same, (int)(prefetched - lastPrefetched), (int)(decoded - lastDecoded));',
+				'\t// stopping mid graph releases everything decoded and not taken',
+				'\tHyperloopPrefetchStop();',
+				'\tHyperloopPrefetchStart("/m0.js");',
+				'\tstd::this_thread::sleep_for(std::chrono::milliseconds(2));',
+				'\tHyperloopPrefetchStop();',
+				'\tstats(prefetched, decoded, ready);',
+				'\tprintf("%d %d\\n", (int)ready, live.load());',
+				'\treturn 0;',
+				'}'
+			],
+			count = 31,
+			files = [];
+
+		for (var c=0;c<count;c++) {
+			var source = new Array(20+c*5).join('var m'+c+' = require("./m'+(2*c+1)+'") + "é€";\n');
+			if (c%4==3) {
+				// some of them base64 like the uncompressed embed format
+				files.push(writeEmbed('prefetch_source'+c, new Buffer(new Buffer(source).toString('base64'))));
+			}
+			else {
+				files.push(writeEmbed('prefetch_source'+c, jsgen.compress(source).source.match(/0x[0-9a-f]+/g).map(function(value){ return parseInt(value,16); })));
+			}
+		}
+
+		compileExecutable('prefetch_graph', main, function(err, exe){
+			if (err) { return done(err); }
+
+			exec(exe+' '+key.toString(16)+' '+files.join(' '), function(err, stdout, stderr) {
+				if (err) { return done(err); }
+
+				var lines = stdout.trim().split('\n');
+				lines.length.should.be.equal(4);
+				// every source decoded ahead and taken ready
+				lines[0].should.be.equal('1 '+count+' 0 0');
+				// taken ready, after a wait or decoded on the JS thread, but once each
+				lines[1].should.be.equal('1 '+count+' 0');
+				lines[2].should.be.equal('1 0 2');
+				lines[3].should.be.equal('0 0');
+
+				done();
+			});
+		});
+	});
+});
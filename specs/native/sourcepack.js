@@ -0,0 +1,197 @@
+/**
+ * source pack specs
+ */
+
+var should = require('should'),
+	wrench = require('wrench'),
+	path = require('path'),
+	fs = require('fs'),
+	exec = require('child_process').exec,
+	clang = require('../../').compiler.clang,
+	sourcepack = require('../../').compiler.sourcepack;
+
+describe("sourcepack", function(){
+
+	var build_dir = path.join(__dirname,'../../','build');
+
+	/**
+	 * compile sourcepack.cpp with main and link it into an executable named name
+	 */
+	function compileExecutable(name, main, callback) {
+		var config = {
+				srcfiles: [],
+				outdir: build_dir,
+				cflags: [ '-I"'+path.join(__dirname,'../../templates')+'"', '-DHL_TEST' ]
+			},
+			mainFile = path.join(build_dir,name+'_main.cpp');
+
+		if (!fs.existsSync(build_dir)) {
+			wrench.mkdirSyncRecursive(build_dir);
+		}
+
+		fs.writeFileSync(mainFile, main.join('\n'), 'utf8');
+
+		config.srcfiles.push({
+			srcfile: path.join(__dirname,'../../templates/sourcepack.cpp'),
+			objfile: path.join(build_dir,name+'_sourcepack.o')
+		});
+
+		config.srcfiles.push({
+			srcfile: mainFile,
+			objfile: mainFile.replace(/\.cpp$/,'.o')
+		});
+
+		clang.compile(config, function(err, results) {
+			if (err) { return callback(err); }
+			results.length.should.be.equal(2);
+
+			var exe = path.join(build_dir, name),
+				cmd = 'clang '+results.join(' ')+' -o "'+exe+'" -lstdc++';
+
+			exec(cmd, function(err,stdout,stderr){
+				callback(err, exe);
+			});
+		});
+	}
+
+	/**
+	 * 32-bit FNV-1a, the same as HyperloopPathHash
+	 */
+	function pathHash(str) {
+		var bytes = new Buffer(str,'utf8'),
+			hash = 0x811c9dc5;
+		for (var c=0;c<bytes.length;c++) {
+			hash ^= bytes[c];
+			hash = (hash + (hash<<1) + (hash<<4) + (hash<<7) + (hash<<8) + (hash<<24)) >>> 0;
+		}
+		return hash;
+	}
+
+	function entry(fn, dirname, source, dependencies, json, utf16, wrapped) {
+		return {
+			path: fn,
+			hash: pathHash(fn),
+			filename: fn,
+			dirname: dirname,
+			source: source===null ? null : new Buffer(source, utf16 ? 'utf16le' : 'utf8'),
+			json: !!json,
+			utf16: !!utf16,
+			wrapped: !!wrapped,
+			dependencies: dependencies
+		};
+	}
+
+	var entries = [
+			entry('/app.js', '/', 'require("./lib/a")', [1, 3]),
+			entry('/lib/a.js', '/lib', 'require("./b.json")', [2], false, false, true),
+			entry('/lib/b.json', '/lib', '{"a":1}', [], true),
+			entry('/lib/native.js', '/lib', null, []),
+			// odd length strings before it so it has to be aligned
+			entry('/lib/utf16.js', '/lib/x', 'exports.s="\u00e9"', [], false, true)
+		],
+		main = [
+			'#include <sourcepack.h>',
+			'#include <string.h>',
+			'#include <stdio.h>',
+			'static uint32_t hash(const char *path) {',
+			'\tuint32_t h = 2166136261u;',
+			'\tfor (; *path; path++) {',
+			'\t\th ^= static_cast<unsigned char>(*path);',
+			'\t\th *= 16777619u;',
+			'\t}',
+			'\treturn h;',
+			'}',
+			'int main(int argc, char **argv){',
+			'\tHyperloop::SourcePack pack;',
+			'\tif (!pack.open(argv[1])) {',
+			'\t\tprintf("invalid\\n");',
+			'\t\treturn 0;',
+			'\t}',
+			'\tfor (int c = 2; c < argc; c++) {',
+			'\t\tauto index = pack.find(argv[c], strlen(argv[c]), hash(argv[c]));',
+			'\t\tif (index == pack.size()) {',
+			'\t\t\tprintf("missing\\n");',
+			'\t\t\tcontinue;',
+			'\t\t}',
+			'\t\tauto &e = pack.entry(index);',
+			'\t\tprintf("%s %s %u %.*s", pack.string(e.filename), pack.string(e.dirname), e.flags, (int)e.sourceLength, pack.source(e));',
+			'\t\tfor (uint32_t d = 0; d < e.dependencyCount; d++) {',
+			'\t\t\tprintf(" %s", pack.string(pack.entry(pack.dependencies(e)[d]).path));',
+			'\t\t}',
+			'\t\tprintf("\\n");',
+			'\t}',
+			'\treturn 0;',
+			'}'
+		];
+
+	it("should write an index sorted by path hash", function(){
+		var read = sourcepack.read(sourcepack.write(entries));
+		read.length.should.be.equal(entries.length);
+		read.forEach(function(e,i){
+			i && e.hash.should.not.be.below(read[i-1].hash);
+			e.hash.should.be.equal(pathHash(e.path));
+		});
+		var app = read.filter(function(e){ return e.path==='/app.js'; })[0];
+		app.source.toString().should.be.equal('require("./lib/a")');
+		app.dependencies.map(function(d){ return read[d].path; }).join(' ').should.be.equal('/lib/a.js /lib/native.js');
+		var utf16 = read.filter(function(e){ return e.utf16; });
+		utf16.length.should.be.equal(1);
+		utf16[0].source.toString('utf16le').should.be.equal('exports.s="\u00e9"');
+		read.filter(function(e){ return e.wrapped; }).map(function(e){ return e.path; }).should.be.eql(['/lib/a.js']);
+	});
+
+	it("should map a pack and find its sources", function(done){
+		if (!fs.existsSync(build_dir)) {
+			wrench.mkdirSyncRecursive(build_dir);
+		}
+		var fn = path.join(build_dir,'sourcepack.hlpack');
+		fs.writeFileSync(fn, sourcepack.write(entries));
+
+		compileExecutable('sourcepack_find', main, function(err, exe){
+			if (err) { return done(err); }
+
+			exec(exe+' '+fn+' /app.js /lib/b.json /lib/native.js /lib/a /lib/a.jsx', function(err, stdout, stderr) {
+				if (err) { return done(err); }
+
+				var lines = stdout.trim().split('\n');
+				lines.length.should.be.equal(5);
+				lines[0].should.be.equal('/app.js / 0 require("./lib/a") /lib/a.js /lib/native.js');
+				lines[1].should.be.equal('/lib/b.json /lib 1 {"a":1}');
+				lines[2].should.be.equal('/lib/native.js /lib 0 ');
+				// only exact paths match
+				lines[3].should.be.equal('missing');
+				lines[4].should.be.equal('missing');
+
+				done();
+			});
+		});
+	});
+
+	it("should reject malformed packs", function(done){
+		if (!fs.existsSync(build_dir)) {
+			wrench.mkdirSyncRecursive(build_dir);
+		}
+		var pack = sourcepack.write(entries),
+			truncated = path.join(build_dir,'sourcepack_truncated.hlpack'),
+			corrupt = path.join(build_dir,'sourcepack_corrupt.hlpack'),
+			damaged = new Buffer(pack.length);
+
+		pack.copy(damaged);
+		// point the first entry's source past the end of the file
+		damaged.writeUInt32LE(pack.length, 16 + 5 * 4);
+		fs.writeFileSync(truncated, pack.slice(0, 40));
+		fs.writeFileSync(corrupt, damaged);
+
+		compileExecutable('sourcepack_invalid', main, function(err, exe){
+			if (err) { return done(err); }
+
+			exec(exe+' '+truncated+' && '+exe+' '+corrupt+' && '+exe+' '+path.join(build_dir,'sourcepack_missing.hlpack'), function(err, stdout, stderr) {
+				if (err) { return done(err); }
+
+				stdout.trim().split('\n').join(' ').should.be.equal('invalid invalid invalid');
+
+				done();
+			});
+		});
+	});
+});
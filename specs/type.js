@@ -137,9 +137,8 @@ describe('#types', function(){
 		var preamble = [], cleanup = [];
 		type.toNativeBody('value',preamble,cleanup).should.equal('valuebuf[0]');
 		preamble.should.not.be.empty;
-		cleanup.should.not.be.empty;
-		preamble[0].should.equal('auto valuebuf = HyperloopJSValueToStringCopy(ctx,value,exception);');
-		cleanup[0].should.equal('delete [] valuebuf;');
+		cleanup.should.be.empty;
+		preamble[0].should.equal('Hyperloop::StringBuffer valuebuf(ctx,value,exception);');
 		type.toJSBody('value').should.equal('HyperloopMakeString(ctx,&value,exception)');
 	});
 
@@ -159,11 +158,10 @@ describe('#types', function(){
 		type.isNativeString().should.be.true;
 		type.isPointer().should.be.true;
 		var preamble = [], cleanup = [];
-		type.toNativeBody('value',preamble,cleanup).should.equal('valuebuf');
+		type.toNativeBody('value',preamble,cleanup).should.equal('valuebuf.data()');
 		preamble.should.not.be.empty;
-		cleanup.should.not.be.empty;
-		preamble[0].should.equal('auto valuebuf = HyperloopJSValueToStringCopy(ctx,value,exception);');
-		cleanup[0].should.equal('delete [] valuebuf;');
+		cleanup.should.be.empty;
+		preamble[0].should.equal('Hyperloop::StringBuffer valuebuf(ctx,value,exception);');
 		type.toJSBody('value').should.equal('HyperloopMakeString(ctx,value,exception)');
 	});
 
@@ -175,11 +173,10 @@ describe('#types', function(){
 		type.isPointer().should.be.true;
 		type.isConst().should.be.true;
 		var preamble = [], cleanup = [];
-		type.toNativeBody('value',preamble,cleanup).should.equal('valuebuf');
+		type.toNativeBody('value',preamble,cleanup).should.equal('valuebuf.data()');
 		preamble.should.not.be.empty;
-		cleanup.should.not.be.empty;
-		preamble[0].should.equal('auto valuebuf = HyperloopJSValueToStringCopy(ctx,value,exception);');
-		cleanup[0].should.equal('delete [] valuebuf;');
+		cleanup.should.be.empty;
+		preamble[0].should.equal('Hyperloop::StringBuffer valuebuf(ctx,value,exception);');
 		type.toJSBody('value').should.equal('HyperloopMakeString(ctx,value,exception)');
 	});
 
@@ -189,11 +186,10 @@ describe('#types', function(){
 		type.isJSString().should.be.true;
 		type.isNativeString().should.be.true;
 		var preamble = [], cleanup = [];
-		type.toNativeBody('value',preamble,cleanup).should.equal('valuebuf');
+		type.toNativeBody('value',preamble,cleanup).should.equal('valuebuf.data()');
 		preamble.should.not.be.empty;
-		cleanup.should.not.be.empty;
-		preamble[0].should.equal('auto valuebuf = HyperloopJSValueToStringCopy(ctx,value,exception);');
-		cleanup[0].should.equal('delete [] valuebuf;');
+		cleanup.should.be.empty;
+		preamble[0].should.equal('Hyperloop::StringBuffer valuebuf(ctx,value,exception);');
 		type.toJSBody('value').should.equal('HyperloopMakeString(ctx,value,exception)');
 		type.getCharArrayLength().should.equal(0); // unlimited
 	});
@@ -204,11 +200,10 @@ describe('#types', function(){
 		type.isJSString().should.be.true;
 		type.isNativeString().should.be.true;
 		var preamble = [], cleanup = [];
-		type.toNativeBody('value',preamble,cleanup).should.equal('valuebuf');
+		type.toNativeBody('value',preamble,cleanup).should.equal('valuebuf.data()');
 		preamble.should.not.be.empty;
-		cleanup.should.not.be.empty;
-		preamble[0].should.equal('auto valuebuf = HyperloopJSValueToStringCopy(ctx,value,exception);');
-		cleanup[0].should.equal('delete [] valuebuf;');
+		cleanup.should.be.empty;
+		preamble[0].should.equal('Hyperloop::StringBuffer valuebuf(ctx,value,exception);');
 		type.toJSBody('value').should.equal('HyperloopMakeString(ctx,value,exception)');
 		type.getCharArrayLength().should.equal(10);
 	});
@@ -220,11 +215,10 @@ describe('#types', function(){
 		type.isNativeString().should.be.true;
 		type.isConst().should.be.true;
 		var preamble = [], cleanup = [];
-		type.toNativeBody('value',preamble,cleanup).should.equal('valuebuf');
+		type.toNativeBody('value',preamble,cleanup).should.equal('valuebuf.data()');
 		preamble.should.not.be.empty;
-		cleanup.should.not.be.empty;
-		preamble[0].should.equal('auto valuebuf = HyperloopJSValueToStringCopy(ctx,value,exception);');
-		cleanup[0].should.equal('delete [] valuebuf;');
+		cleanup.should.be.empty;
+		preamble[0].should.equal('Hyperloop::StringBuffer valuebuf(ctx,value,exception);');
 		type.toJSBody('value').should.equal('HyperloopMakeString(ctx,value,exception)');
 		type.getCharArrayLength().should.equal(0); // unlimited
 	});
@@ -236,11 +230,10 @@ describe('#types', function(){
 		type.isNativeString().should.be.true;
 		type.isConst().should.be.true;
 		var preamble = [], cleanup = [];
-		type.toNativeBody('value',preamble,cleanup).should.equal('valuebuf');
+		type.toNativeBody('value',preamble,cleanup).should.equal('valuebuf.data()');
 		preamble.should.not.be.empty;
-		cleanup.should.not.be.empty;
-		preamble[0].should.equal('auto valuebuf = HyperloopJSValueToStringCopy(ctx,value,exception);');
-		cleanup[0].should.equal('delete [] valuebuf;');
+		cleanup.should.be.empty;
+		preamble[0].should.equal('Hyperloop::StringBuffer valuebuf(ctx,value,exception);');
 		type.toJSBody('value').should.equal('HyperloopMakeString(ctx,value,exception)');
 		type.getCharArrayLength().should.equal(10);
 	});
@@ -1174,11 +1167,10 @@ describe('#types', function(){
 		typelib.metabase = {};
 		var type = typelib.resolveType('const char *');
 		var preamble = [], cleanup = [], declares = [];
-		type.toNativeBody('arguments[1]',preamble,cleanup,declares).should.equal('arguments_1_buf');
+		type.toNativeBody('arguments[1]',preamble,cleanup,declares).should.equal('arguments_1_buf.data()');
 		preamble.should.not.be.empty;
-		preamble[0].should.be.equal('auto arguments_1_buf = HyperloopJSValueToStringCopy(ctx,arguments[1],exception);');
-		cleanup.should.not.be.empty;
-		cleanup[0].should.be.equal('delete [] arguments_1_buf;');
+		preamble[0].should.be.equal('Hyperloop::StringBuffer arguments_1_buf(ctx,arguments[1],exception);');
+		cleanup.should.be.empty;
 		declares.should.be.empty;
 	});
 
@@ -0,0 +1,220 @@
+/**
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License
+ * Please see the LICENSE included with this distribution for details.
+ *
+ * This code and related technologies are covered by patents
+ * or patents pending by Appcelerator, Inc.
+ */
+#ifndef __HYPERLOOP_OBJECTPOOL_HEADER__
+#define __HYPERLOOP_OBJECTPOOL_HEADER__
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+
+namespace Hyperloop
+{
+
+/**
+ * native object wrappers are carved out of per size class slabs unless
+ * HL_NATIVE_OBJECT_POOL is defined to 0, in which case they use the global heap
+ */
+#ifndef HL_NATIVE_OBJECT_POOL
+#define HL_NATIVE_OBJECT_POOL 1
+#endif
+
+/**
+ * fixed size block allocator. blocks come from slabs of SlabBlocks blocks and
+ * are recycled through a free list per thread. when a thread exits its free
+ * list moves to a shared depot which other threads refill from. slabs are kept
+ * for the life of the process
+ */
+template <size_t Size>
+class ObjectPool
+{
+public:
+    static const size_t SlabBlocks = 64;
+
+    static void* allocate()
+    {
+        if (threadExited())
+        {
+            // allocation from a thread cache destructor, don't touch the cache
+            live.fetch_add(1, std::memory_order_relaxed);
+            return ::operator new(sizeof(Block));
+        }
+        auto &cache = threadCache();
+        if (cache.head == nullptr)
+        {
+            refill(cache);
+        }
+        auto block = cache.head;
+        cache.head = block->next;
+        cached.fetch_sub(1, std::memory_order_relaxed);
+        live.fetch_add(1, std::memory_order_relaxed);
+        return block;
+    }
+
+    static void deallocate(void *pointer)
+    {
+        auto block = static_cast<Block *>(pointer);
+        live.fetch_sub(1, std::memory_order_relaxed);
+        cached.fetch_add(1, std::memory_order_relaxed);
+        if (threadExited())
+        {
+            // the thread cache is gone, hand the block straight to the depot
+            std::lock_guard<std::mutex> lock(depotMutex());
+            block->next = depot();
+            depot() = block;
+            return;
+        }
+        auto &cache = threadCache();
+        block->next = cache.head;
+        cache.head = block;
+    }
+
+    /**
+     * number of blocks handed out and not yet returned
+     */
+    static size_t liveBlocks()
+    {
+        return live.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * number of free blocks held by thread caches and the depot
+     */
+    static size_t cachedBlocks()
+    {
+        return cached.load(std::memory_order_relaxed);
+    }
+
+private:
+    union Block
+    {
+        Block *next;
+        std::max_align_t align;
+        char storage[Size];
+    };
+
+    struct Cache
+    {
+        Block *head = nullptr;
+
+        ~Cache()
+        {
+            threadExited() = true;
+            if (head == nullptr)
+            {
+                return;
+            }
+            auto tail = head;
+            while (tail->next != nullptr)
+            {
+                tail = tail->next;
+            }
+            std::lock_guard<std::mutex> lock(depotMutex());
+            tail->next = depot();
+            depot() = head;
+            head = nullptr;
+        }
+    };
+
+    static Cache& threadCache()
+    {
+        static thread_local Cache cache;
+        return cache;
+    }
+
+    static bool& threadExited()
+    {
+        static thread_local bool exited = false;
+        return exited;
+    }
+
+    static std::mutex& depotMutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    static Block*& depot()
+    {
+        static Block *head = nullptr;
+        return head;
+    }
+
+    static void refill(Cache &cache)
+    {
+        {
+            std::lock_guard<std::mutex> lock(depotMutex());
+            if (depot() != nullptr)
+            {
+                cache.head = depot();
+                depot() = nullptr;
+                return;
+            }
+        }
+        auto slab = static_cast<Block *>(::operator new(SlabBlocks * sizeof(Block)));
+        for (size_t c = 0; c < SlabBlocks - 1; c++)
+        {
+            slab[c].next = &slab[c + 1];
+        }
+        slab[SlabBlocks - 1].next = nullptr;
+        cache.head = slab;
+        cached.fetch_add(SlabBlocks, std::memory_order_relaxed);
+    }
+
+    static std::atomic<size_t> live;
+    static std::atomic<size_t> cached;
+};
+
+template <size_t Size>
+std::atomic<size_t> ObjectPool<Size>::live(0);
+
+template <size_t Size>
+std::atomic<size_t> ObjectPool<Size>::cached(0);
+
+#define HYPERLOOP_OBJECT_POOL_SIZES(V) V(16) V(32) V(48) V(64) V(96) V(128)
+
+/**
+ * allocate size bytes from the smallest pool that fits, or the global heap
+ */
+inline void* PoolAllocate(size_t size)
+{
+#define HYPERLOOP_POOL_ALLOCATE(n) if (size <= n) return ObjectPool<n>::allocate();
+    HYPERLOOP_OBJECT_POOL_SIZES(HYPERLOOP_POOL_ALLOCATE)
+#undef HYPERLOOP_POOL_ALLOCATE
+    return ::operator new(size);
+}
+
+/**
+ * return memory from PoolAllocate. size must be the size it was allocated with
+ */
+inline void PoolDeallocate(void *pointer, size_t size)
+{
+#define HYPERLOOP_POOL_DEALLOCATE(n) if (size <= n) { ObjectPool<n>::deallocate(pointer); return; }
+    HYPERLOOP_OBJECT_POOL_SIZES(HYPERLOOP_POOL_DEALLOCATE)
+#undef HYPERLOOP_POOL_DEALLOCATE
+    ::operator delete(pointer);
+}
+
+/**
+ * totals across all native object pools: blocks in use and blocks free for reuse
+ */
+inline void NativeObjectPoolStats(size_t &live, size_t &cached)
+{
+    live = 0;
+    cached = 0;
+#if HL_NATIVE_OBJECT_POOL
+#define HYPERLOOP_POOL_STATS(n) live += ObjectPool<n>::liveBlocks(); cached += ObjectPool<n>::cachedBlocks();
+    HYPERLOOP_OBJECT_POOL_SIZES(HYPERLOOP_POOL_STATS)
+#undef HYPERLOOP_POOL_STATS
+#endif
+}
+
+}
+
+#endif
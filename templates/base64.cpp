@@ -25,60 +25,333 @@
 
    http://www.adp-gmbh.ch/cpp/common/base64.html
 
+   Altered for Hyperloop: table driven decoding into a caller supplied
+   buffer with SSSE3/AVX2/NEON fast paths.
+
 */
 #ifndef HL_TEST
 #include <hyperloop.h>
 #else
 #include <base64.h>
 #endif
+#include <string.h>
+
+/**
+ * SIMD paths are chosen at compile time.  each one only consumes blocks that
+ * are entirely valid base64 and leaves padding, invalid characters and the
+ * tail to the scalar decoder so the results are always identical.
+ */
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define HL_BASE64_SSSE3 1
+#define HL_BASE64_AVX2 1
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#define HL_BASE64_SSSE3 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define HL_BASE64_NEON 1
+#endif
 
-static const std::string base64_chars =
-"ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-"abcdefghijklmnopqrstuvwxyz"
-"0123456789+/";
+/**
+ * maps a character to its 6 bit value or 0xFF if not a base64 character
+ */
+static const unsigned char base64_table[256] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x3E, 0xFF, 0xFF, 0xFF, 0x3F,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
+    0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+};
 
+#if defined(HL_BASE64_SSSE3) || defined(HL_BASE64_NEON)
+/**
+ * nibble lookup tables (Mula/Lemire). a character is invalid when
+ * lut_lo[low nibble] & lut_hi[high nibble] is non-zero, otherwise its value
+ * is the character plus lut_roll[high nibble] ('/' uses high nibble - 1).
+ */
+static const unsigned char base64_lut_lo[16] = {
+    0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A
+};
+static const unsigned char base64_lut_hi[16] = {
+    0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10
+};
+static const signed char base64_lut_roll[16] = {
+    0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0
+};
+#endif
 
-static inline bool is_base64(unsigned char c) {
-    return (isalnum(c) || (c == '+') || (c == '/'));
+size_t base64_decoded_length(const char *encoded, size_t length)
+{
+    while (length > 0 && encoded[length - 1] == '=') {
+        length--;
+    }
+    size_t remainder = length % 4;
+    return (length / 4) * 3 + (remainder > 1 ? remainder - 1 : 0);
+}
+
+size_t base64_decode(const char *encoded, size_t length, unsigned char *decoded)
+{
+    const unsigned char *in = reinterpret_cast<const unsigned char *>(encoded);
+    unsigned char *out = decoded;
+
+#ifdef HL_BASE64_AVX2
+    {
+        const __m256i lut_lo = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(base64_lut_lo)));
+        const __m256i lut_hi = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(base64_lut_hi)));
+        const __m256i lut_roll = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(base64_lut_roll)));
+        const __m256i mask_0F = _mm256_set1_epi8(0x0F);
+        const __m256i slash = _mm256_set1_epi8(0x2F);
+        const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                              2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+        const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+        unsigned char block[32];
+        while (length >= 32) {
+            __m256i str = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in));
+            __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(str, 4), mask_0F);
+            __m256i lo_nibbles = _mm256_and_si256(str, mask_0F);
+            __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+            __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+            if (!_mm256_testz_si256(lo, hi)) {
+                break;
+            }
+            __m256i roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(_mm256_cmpeq_epi8(str, slash), hi_nibbles));
+            str = _mm256_add_epi8(str, roll);
+            str = _mm256_maddubs_epi16(str, _mm256_set1_epi32(0x01400140));
+            str = _mm256_madd_epi16(str, _mm256_set1_epi32(0x00011000));
+            str = _mm256_shuffle_epi8(str, pack);
+            str = _mm256_permutevar8x32_epi32(str, lanes);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(block), str);
+            memcpy(out, block, 24);
+            in += 32;
+            out += 24;
+            length -= 32;
+        }
+    }
+#endif
+
+#ifdef HL_BASE64_SSSE3
+    {
+        const __m128i lut_lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(base64_lut_lo));
+        const __m128i lut_hi = _mm_loadu_si128(reinterpret_cast<const __m128i *>(base64_lut_hi));
+        const __m128i lut_roll = _mm_loadu_si128(reinterpret_cast<const __m128i *>(base64_lut_roll));
+        const __m128i mask_0F = _mm_set1_epi8(0x0F);
+        const __m128i slash = _mm_set1_epi8(0x2F);
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+        unsigned char block[16];
+        while (length >= 16) {
+            __m128i str = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in));
+            __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(str, 4), mask_0F);
+            __m128i lo_nibbles = _mm_and_si128(str, mask_0F);
+            __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+            __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, hi), zero)) != 0xFFFF) {
+                break;
+            }
+            __m128i roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(_mm_cmpeq_epi8(str, slash), hi_nibbles));
+            str = _mm_add_epi8(str, roll);
+            str = _mm_maddubs_epi16(str, _mm_set1_epi32(0x01400140));
+            str = _mm_madd_epi16(str, _mm_set1_epi32(0x00011000));
+            str = _mm_shuffle_epi8(str, pack);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(block), str);
+            memcpy(out, block, 12);
+            in += 16;
+            out += 12;
+            length -= 16;
+        }
+    }
+#endif
+
+#ifdef HL_BASE64_NEON
+    {
+        const uint8x16_t lut_lo = vld1q_u8(base64_lut_lo);
+        const uint8x16_t lut_hi = vld1q_u8(base64_lut_hi);
+        const uint8x16_t lut_roll = vld1q_u8(reinterpret_cast<const uint8_t *>(base64_lut_roll));
+        const uint8x16_t mask_0F = vdupq_n_u8(0x0F);
+        const uint8x16_t slash = vdupq_n_u8(0x2F);
+        while (length >= 64) {
+            // de-interleave so that each register holds one position of 16 quads
+            uint8x16x4_t str = vld4q_u8(in);
+            uint8x16_t invalid = vdupq_n_u8(0);
+            for (int i = 0; i < 4; i++) {
+                uint8x16_t hi_nibbles = vshrq_n_u8(str.val[i], 4);
+                uint8x16_t lo_nibbles = vandq_u8(str.val[i], mask_0F);
+                invalid = vorrq_u8(invalid, vandq_u8(vqtbl1q_u8(lut_lo, lo_nibbles), vqtbl1q_u8(lut_hi, hi_nibbles)));
+                uint8x16_t roll = vqtbl1q_u8(lut_roll, vaddq_u8(vceqq_u8(str.val[i], slash), hi_nibbles));
+                str.val[i] = vaddq_u8(str.val[i], roll);
+            }
+            if (vmaxvq_u8(invalid) != 0) {
+                break;
+            }
+            uint8x16x3_t dec;
+            dec.val[0] = vorrq_u8(vshlq_n_u8(str.val[0], 2), vshrq_n_u8(str.val[1], 4));
+            dec.val[1] = vorrq_u8(vshlq_n_u8(str.val[1], 4), vshrq_n_u8(str.val[2], 2));
+            dec.val[2] = vorrq_u8(vshlq_n_u8(str.val[2], 6), str.val[3]);
+            vst3q_u8(out, dec);
+            in += 64;
+            out += 48;
+            length -= 64;
+        }
+    }
+#endif
+
+    // whole quads
+    while (length >= 4) {
+        unsigned int a = base64_table[in[0]];
+        unsigned int b = base64_table[in[1]];
+        unsigned int c = base64_table[in[2]];
+        unsigned int d = base64_table[in[3]];
+        if ((a | b | c | d) & 0x80) {
+            break;
+        }
+        unsigned int triple = (a << 18) | (b << 12) | (c << 6) | d;
+        out[0] = static_cast<unsigned char>(triple >> 16);
+        out[1] = static_cast<unsigned char>(triple >> 8);
+        out[2] = static_cast<unsigned char>(triple);
+        in += 4;
+        out += 3;
+        length -= 4;
+    }
+
+    // partial quad up to the first '=' or non base64 character
+    unsigned int quad[4] = { 0, 0, 0, 0 };
+    size_t i = 0;
+    while (i < 4 && i < length && base64_table[in[i]] != 0xFF) {
+        quad[i] = base64_table[in[i]];
+        i++;
+    }
+    if (i > 1) {
+        unsigned int triple = (quad[0] << 18) | (quad[1] << 12) | (quad[2] << 6) | quad[3];
+        out[0] = static_cast<unsigned char>(triple >> 16);
+        if (i > 2) {
+            out[1] = static_cast<unsigned char>(triple >> 8);
+        }
+        out += i - 1;
+    }
+
+    return static_cast<size_t>(out - decoded);
 }
 
 std::string base64_decode(std::string const& encoded_string) {
-    int in_len = encoded_string.size();
-    int i = 0;
-    int j = 0;
-    int in_ = 0;
-    unsigned char char_array_4[4], char_array_3[3];
     std::string ret;
-    
-    while (in_len-- && ( encoded_string[in_] != '=') && is_base64(encoded_string[in_])) {
-        char_array_4[i++] = encoded_string[in_]; in_++;
-        if (i ==4) {
-            for (i = 0; i <4; i++)
-                char_array_4[i] = base64_chars.find(char_array_4[i]);
-            
-            char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-            char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-            char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-            
-            for (i = 0; (i < 3); i++)
-                ret += char_array_3[i];
-            i = 0;
+    ret.resize(base64_decoded_length(encoded_string.data(), encoded_string.size()));
+    if (!ret.empty()) {
+        ret.resize(base64_decode(encoded_string.data(), encoded_string.size(), reinterpret_cast<unsigned char *>(&ret[0])));
+    }
+    return ret;
+}
+
+/**
+ * incremental UTF-8 to UTF-16 converter so that sequences can span chunks
+ */
+struct utf8_to_utf16_state {
+    unsigned int codepoint;
+    unsigned int minimum;
+    int needed;
+};
+
+static inline unsigned short *utf8_to_utf16_flush(utf8_to_utf16_state &state, unsigned short *out)
+{
+    if (state.needed) {
+        *out++ = 0xFFFD;
+        state.needed = 0;
+    }
+    return out;
+}
+
+static unsigned short *utf8_to_utf16(utf8_to_utf16_state &state, const unsigned char *in, size_t length, unsigned short *out)
+{
+    for (size_t i = 0; i < length; i++) {
+        unsigned int c = in[i];
+        if (state.needed == 0) {
+            if (c < 0x80) {
+                *out++ = static_cast<unsigned short>(c);
+            } else if ((c & 0xE0) == 0xC0) {
+                state.codepoint = c & 0x1F;
+                state.minimum = 0x80;
+                state.needed = 1;
+            } else if ((c & 0xF0) == 0xE0) {
+                state.codepoint = c & 0x0F;
+                state.minimum = 0x800;
+                state.needed = 2;
+            } else if ((c & 0xF8) == 0xF0) {
+                state.codepoint = c & 0x07;
+                state.minimum = 0x10000;
+                state.needed = 3;
+            } else {
+                *out++ = 0xFFFD;
+            }
+        } else if ((c & 0xC0) == 0x80) {
+            state.codepoint = (state.codepoint << 6) | (c & 0x3F);
+            if (--state.needed == 0) {
+                unsigned int cp = state.codepoint;
+                if (cp < state.minimum || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+                    *out++ = 0xFFFD;
+                } else if (cp >= 0x10000) {
+                    cp -= 0x10000;
+                    *out++ = static_cast<unsigned short>(0xD800 + (cp >> 10));
+                    *out++ = static_cast<unsigned short>(0xDC00 + (cp & 0x3FF));
+                } else {
+                    *out++ = static_cast<unsigned short>(cp);
+                }
+            }
+        } else {
+            // truncated sequence, replace it and start over with this byte
+            out = utf8_to_utf16_flush(state, out);
+            i--;
         }
     }
-    
-    if (i) {
-        for (j = i; j <4; j++)
-            char_array_4[j] = 0;
-        
-        for (j = 0; j <4; j++)
-            char_array_4[j] = base64_chars.find(char_array_4[j]);
-        
-        char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-        char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-        char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-        
-        for (j = 0; (j < i - 1); j++) ret += char_array_3[j];
+    return out;
+}
+
+size_t utf8_decode_utf16(const unsigned char *utf8, size_t length, unsigned short *decoded)
+{
+    utf8_to_utf16_state state = { 0, 0, 0 };
+    unsigned short *out = utf8_to_utf16(state, utf8, length, decoded);
+    out = utf8_to_utf16_flush(state, out);
+    return static_cast<size_t>(out - decoded);
+}
+
+size_t base64_decode_utf16(const char *encoded, size_t length, unsigned char key, unsigned short *decoded)
+{
+    // stream through a small cache resident window instead of materializing
+    // the de-obfuscated text and the decoded UTF-8 for the whole source
+    char chunk[3072];
+    unsigned char bytes[sizeof(chunk) / 4 * 3];
+    utf8_to_utf16_state state = { 0, 0, 0 };
+    unsigned short *out = decoded;
+
+    while (length > 0) {
+        size_t count = length < sizeof(chunk) ? length : sizeof(chunk);
+        for (size_t i = 0; i < count; i++) {
+            chunk[i] = encoded[i] ^ key;
+        }
+        size_t written = base64_decode(chunk, count, bytes);
+        out = utf8_to_utf16(state, bytes, written, out);
+        if (written < count / 4 * 3) {
+            // reached padding or a non base64 character
+            break;
+        }
+        encoded += count;
+        length -= count;
     }
-    
-    return ret;
+    out = utf8_to_utf16_flush(state, out);
+
+    // don't leave decoded source lying around on the stack
+    memset(chunk, 0, sizeof(chunk));
+    memset(bytes, 0, sizeof(bytes));
+
+    return static_cast<size_t>(out - decoded);
 }
@@ -25,12 +25,46 @@
 
    http://www.adp-gmbh.ch/cpp/common/base64.html
 
+   Altered for Hyperloop: table driven decoding into a caller supplied
+   buffer with SSSE3/AVX2/NEON fast paths.
+
 */
 #ifndef __BASE64_HEADER__
 #define __BASE64_HEADER__
 
 #include <string>
+#include <stddef.h>
+
+/**
+ * return the number of bytes needed to decode length characters of encoded.
+ * trailing '=' padding is not counted so this is exact for well formed input
+ * and an upper bound otherwise.
+ */
+size_t base64_decoded_length(const char *encoded, size_t length);
+
+/**
+ * decode length characters of encoded into decoded, which must have room for
+ * at least base64_decoded_length(encoded, length) bytes. decoding stops at the
+ * first '=' or non base64 character. returns the number of bytes written.
+ */
+size_t base64_decode(const char *encoded, size_t length, unsigned char *decoded);
 
 std::string base64_decode(std::string const& s);
 
+/**
+ * decode length characters of base64 encoded UTF-8 text that has been
+ * obfuscated by XOR'ing every character with key, writing UTF-16 code units
+ * into decoded. decoded must have room for (length / 4 + 1) * 3 units.
+ * malformed UTF-8 sequences are replaced with U+FFFD. returns the number of
+ * UTF-16 code units written.
+ */
+size_t base64_decode_utf16(const char *encoded, size_t length, unsigned char key, unsigned short *decoded);
+
+/**
+ * convert length bytes of UTF-8 into UTF-16 code units in decoded, which must
+ * have room for length units. malformed sequences are replaced with U+FFFD.
+ * returns the number of UTF-16 code units written.
+ */
+size_t utf8_decode_utf16(const unsigned char *utf8, size_t length, unsigned short *decoded);
+
 #endif
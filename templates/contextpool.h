@@ -0,0 +1,157 @@
+/**
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License
+ * Please see the LICENSE included with this distribution for details.
+ *
+ * This code and related technologies are covered by patents
+ * or patents pending by Appcelerator, Inc.
+ */
+#ifndef __HYPERLOOP_CONTEXTPOOL_HEADER__
+#define __HYPERLOOP_CONTEXTPOOL_HEADER__
+
+#include <mutex>
+#include <vector>
+#include <stddef.h>
+
+namespace Hyperloop
+{
+    /**
+     * counters of a ContextPool
+     */
+    struct ContextPoolStats
+    {
+        size_t size;
+        size_t available;
+        size_t inUse;
+        size_t highWater;
+        size_t created;
+        size_t reused;
+        size_t discarded;
+    };
+
+    /**
+     * contexts created ahead of time and handed out one at a time. the pool
+     * only keeps the books, creating and releasing contexts is up to the caller
+     */
+    template <typename Context>
+    class ContextPool
+    {
+    public:
+        explicit ContextPool(size_t size) : size(size) {}
+
+        /**
+         * take a context out of the pool. an empty pool is filled back up to
+         * its size with create() first, and create() makes one more if the
+         * size is 0
+         */
+        template <typename Create>
+        Context checkout(Create create)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto warmed = available.empty();
+            if (warmed)
+            {
+                warm(create);
+            }
+            Context ctx;
+            if (!available.empty())
+            {
+                ctx = available.back();
+                available.pop_back();
+                if (!warmed)
+                {
+                    reused++;
+                }
+            }
+            else
+            {
+                ctx = create();
+                created++;
+            }
+            inUse++;
+            if (inUse > highWater)
+            {
+                highWater = inUse;
+            }
+            return ctx;
+        }
+
+        /**
+         * give back a checked out context. returns false if the pool is full
+         * or the context isn't clean, in which case the caller releases it
+         */
+        bool checkin(Context ctx, bool clean)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            inUse--;
+            if (clean && available.size() + inUse < size)
+            {
+                available.push_back(ctx);
+                return true;
+            }
+            discarded++;
+            return false;
+        }
+
+        /**
+         * change the size and fill the pool up to it with create(). returns the
+         * contexts that no longer fit for the caller to release
+         */
+        template <typename Create>
+        std::vector<Context> resize(size_t newSize, Create create)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::vector<Context> excess;
+            size = newSize;
+            while (!available.empty() && available.size() + inUse > size)
+            {
+                excess.push_back(available.back());
+                available.pop_back();
+            }
+            warm(create);
+            return excess;
+        }
+
+        /**
+         * empty the pool and return its contexts for the caller to release
+         */
+        std::vector<Context> drain()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::vector<Context> contexts;
+            contexts.swap(available);
+            return contexts;
+        }
+
+        ContextPoolStats stats()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return ContextPoolStats{size, available.size(), inUse, highWater, created, reused, discarded};
+        }
+
+    private:
+        /**
+         * create contexts until the pool holds size of them. the caller holds the mutex
+         */
+        template <typename Create>
+        void warm(Create create)
+        {
+            while (available.size() + inUse < size)
+            {
+                available.push_back(create());
+                created++;
+            }
+        }
+
+        std::mutex mutex;
+        std::vector<Context> available;
+        size_t size;
+        size_t inUse = 0;
+        size_t highWater = 0;
+        size_t created = 0;
+        size_t reused = 0;
+        size_t discarded = 0;
+    };
+}
+
+#endif
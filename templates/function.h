@@ -0,0 +1,36 @@
+/**
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License
+ * Please see the LICENSE included with this distribution for details.
+ *
+ * This code and related technologies are covered by patents
+ * or patents pending by Appcelerator, Inc.
+ */
+#ifndef __HYPERLOOP_FUNCTION_HEADER__
+#define __HYPERLOOP_FUNCTION_HEADER__
+
+namespace Hyperloop
+{
+    /**
+     * make an object of cls, a class with callAsFunction, that inherits from
+     * Function.prototype so call, apply and bind work on it like on any other
+     * function. functionName and prototypeName are "Function" and "prototype"
+     */
+    inline JSObjectRef MakeFunctionObject(JSContextRef ctx, JSClassRef cls, void *data, JSStringRef functionName, JSStringRef prototypeName)
+    {
+        auto object = JSObjectMake(ctx,cls,data);
+        auto global = JSContextGetGlobalObject(ctx);
+        auto function = JSObjectGetProperty(ctx,global,functionName,nullptr);
+        if (function!=nullptr && JSValueIsObject(ctx,function))
+        {
+            auto prototype = JSObjectGetProperty(ctx,JSValueToObject(ctx,function,nullptr),prototypeName,nullptr);
+            if (prototype!=nullptr && JSValueIsObject(ctx,prototype))
+            {
+                JSObjectSetPrototype(ctx,object,prototype);
+            }
+        }
+        return object;
+    }
+}
+
+#endif
@@ -12,6 +12,10 @@
 #include <sstream>
 #include <memory>
 #include <string>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <cstring>
 
 //-----------------------------------------------------------------------------//
 //                                 PRIVATE                                     //
@@ -23,8 +27,40 @@
 static JSGlobalContextRef globalContextRef = nullptr;
 static JSContextGroupRef globalContextGroupRef = nullptr;
 
+#if !HL_JSVALUE_IS_ARRAY
+/**
+ * Array.isArray resolved from the global context, protected until DestroyHyperloop
+ */
+static JSObjectRef isArrayFunctionRef = nullptr;
+#endif
+
 typedef Hyperloop::NativeObject<void *> * NativeVoid;
 
+/**
+ * class of the objects returned by HyperloopVoidPointerToJSValue
+ */
+static JSClassRef voidPointerClassRef = nullptr;
+
+/**
+ * weak object map per JS class of native pointer to the JS object wrapping it.
+ * the mutex guards maps and the counters and is never held across a JSC call
+ */
+struct WrapperCache
+{
+    std::mutex mutex;
+#if HL_WRAPPER_CACHE
+    std::unordered_map<JSClassRef, JSWeakObjectMapRef> maps;
+#endif
+    size_t hits = 0;
+    size_t misses = 0;
+};
+
+static WrapperCache& GetWrapperCache()
+{
+    static WrapperCache cache;
+    return cache;
+}
+
 /**
  * internal method to return NativeObject
  */
@@ -78,74 +114,272 @@ static JSValueRef HyperloopLogger (JSContextRef ctx, JSObjectRef function, JSObj
 {
     if (argumentCount>0) 
     {
-        std::ostringstream stream;
+        // formatted in place into a per thread buffer that keeps its capacity
+        static thread_local std::string line;
+        line.clear();
         for (size_t c=0;c<argumentCount;c++)
         {
             if (JSValueIsObject(ctx,arguments[c]) || JSValueIsString(ctx,arguments[c])) 
             {
-                std::string str(HyperloopJSValueToStringCopy(ctx,arguments[c],exception));
-                stream << str;
+                auto str = JSValueToStringCopy(ctx,arguments[c],exception);
+                if (str)
+                {
+                    auto offset = line.size();
+                    line.resize(offset + JSStringGetMaximumUTF8CStringSize(str));
+                    auto written = JSStringGetUTF8CString(str,&line[offset],line.size() - offset);
+                    line.resize(offset + (written ? written - 1 : 0));
+                    JSStringRelease(str);
+                }
             }
             else if (JSValueIsNumber(ctx,arguments[c]))
             {
+                // same formatting as std::ostream's default for doubles
+                char buf[32];
                 double num = JSValueToNumber(ctx,arguments[c],exception);
-                double intpart;
-                if (modf(num, &intpart) == 0.0)
-                {
-                    stream << intpart;
-                }
-                else 
-                {
-                    stream << num;
-                }
+                line.append(buf, snprintf(buf, sizeof(buf), "%g", num));
             }
             else if (JSValueIsBoolean(ctx,arguments[c]))
             {
                 bool b = JSValueToBoolean(ctx,arguments[c]);
-                stream << (b ? "true":"false");
+                line.append(b ? "true":"false");
             }
             else if (JSValueIsNull(ctx,arguments[c]))
             {
-                stream << "null";
+                line.append("null");
             }
             else if (JSValueIsUndefined(ctx,arguments[c]))
             {
-                stream << "undefined";
+                line.append("undefined");
             }
             if (c+1 < argumentCount) 
             {
-                stream << " ";
+                line.push_back(' ');
             }
         }
-        // call the platform adapter
-        HyperloopNativeLogger(stream.str().c_str());
+        // queue for the platform adapter
+        HyperloopLog(line.c_str(), line.size());
     }
     return JSValueMakeUndefined(ctx);
 }
 
+#ifndef HL_VM_CONTEXT_POOL_SIZE
+#define HL_VM_CONTEXT_POOL_SIZE 4
+#endif
+
+static void InitializeContext (JSGlobalContextRef ctx);
+
+/**
+ * contexts for runInNewContext, created in the hyperloop context group and set
+ * up by InitializeContext ahead of time. a context goes back to the pool once
+ * the enumerable properties the script left on its global object are deleted;
+ * if any of them can't be deleted the context is released instead. changes
+ * made to builtin objects (such as Array.prototype) are not undone
+ */
+static Hyperloop::ContextPool<JSGlobalContextRef>& GetContextPool()
+{
+    static Hyperloop::ContextPool<JSGlobalContextRef> pool(HL_VM_CONTEXT_POOL_SIZE);
+    return pool;
+}
+
+/**
+ * internal
+ *
+ * create a context for the pool
+ */
+static JSGlobalContextRef CreatePooledContext()
+{
+    auto ctx = JSGlobalContextCreateInGroup(globalContextGroupRef,nullptr);
+    InitializeContext(ctx);
+    return ctx;
+}
+
 /**
- * run JS in a new context and return result
+ * internal
+ *
+ * take a context out of the pool, creating one if the pool is empty
+ */
+static JSGlobalContextRef CheckoutContext()
+{
+    return GetContextPool().checkout(CreatePooledContext);
+}
+
+/**
+ * internal
+ *
+ * delete the enumerable properties of the context's global object, returns
+ * false if any of them couldn't be deleted
+ */
+static bool ResetContextGlobals(JSGlobalContextRef ctx)
+{
+    auto global = JSContextGetGlobalObject(ctx);
+    auto names = JSObjectCopyPropertyNames(ctx, global);
+    auto count = JSPropertyNameArrayGetCount(names);
+    bool clean = true;
+    for (size_t c = 0; c < count; c++)
+    {
+        JSValueRef exception = nullptr;
+        if (!JSObjectDeleteProperty(ctx, global, JSPropertyNameArrayGetNameAtIndex(names, c), &exception) || exception)
+        {
+            clean = false;
+        }
+    }
+    JSPropertyNameArrayRelease(names);
+    return clean;
+}
+
+/**
+ * internal
+ *
+ * return a context to the pool, or release it if the pool is full or it can't be reset
+ */
+static void RecycleContext(JSGlobalContextRef ctx)
+{
+    if (!GetContextPool().checkin(ctx, ResetContextGlobals(ctx)))
+    {
+        JSGlobalContextRelease(ctx);
+    }
+}
+
+/**
+ * internal
+ *
+ * release every pooled context
+ */
+static void DrainContextPool()
+{
+    for (auto ctx : GetContextPool().drain())
+    {
+        JSGlobalContextRelease(ctx);
+    }
+}
+
+/**
+ * run JS in a pooled context and return result
  */
 static JSValueRef RunInNewContext(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception)
 {
     if (argumentCount > 0) 
     {
-        std::ostringstream stream;
-        std::string js(HyperloopJSValueToStringCopy(ctx,arguments[0],exception));
-        stream << "(function(){" << js << "})";
-        auto newCtx = JSGlobalContextCreateInGroup(globalContextGroupRef,nullptr);
-        auto scriptRef = JSStringCreateWithUTF8CString(stream.str().c_str());
+        Hyperloop::StringBuffer js(ctx,arguments[0],exception);
+        std::string script;
+        script.reserve(js.size() + 14);
+        script.append("(function(){").append(js.c_str(), js.size()).append("})");
+        auto newCtx = CheckoutContext();
+        auto scriptRef = JSStringCreateWithUTF8CString(script.c_str());
         auto thisObjectRef = argumentCount > 1 ? JSValueToObject(ctx,arguments[1],exception) : thisObject;
         auto functionRef = JSEvaluateScript(newCtx,scriptRef,thisObjectRef,nullptr,0,exception);
         auto functionObj = JSValueToObject(newCtx,functionRef,exception);
         auto resultRef = JSObjectCallAsFunction(newCtx,functionObj,thisObjectRef,0,nullptr,exception);
         JSStringRelease(scriptRef);
-        JSGlobalContextRelease(newCtx);
+        RecycleContext(newCtx);
         return resultRef;
     } 
     return JSValueMakeUndefined(ctx);   
 }
 
+/**
+ * set the number of contexts kept for runInNewContext and create them now
+ */
+static JSValueRef SetContextPoolSize(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception)
+{
+    if (argumentCount < 1 || !JSValueIsNumber(ctx, arguments[0]))
+    {
+        *exception = HyperloopMakeException(ctx, "setContextPoolSize requires a number");
+        return JSValueMakeUndefined(ctx);
+    }
+    auto size = JSValueToNumber(ctx, arguments[0], exception);
+    for (auto c : GetContextPool().resize(size > 0 ? static_cast<size_t>(size) : 0, CreatePooledContext))
+    {
+        JSGlobalContextRelease(c);
+    }
+    return JSValueMakeUndefined(ctx);
+}
+
+/**
+ * return {size, available, inUse, highWater, created, reused, discarded} of the context pool
+ */
+static JSValueRef ContextPoolStats(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception)
+{
+    auto pool = GetContextPool().stats();
+    auto result = JSObjectMake(ctx, 0, 0);
+    JSObjectSetProperty(ctx, result, HyperloopInternString("size"), JSValueMakeNumber(ctx, pool.size), 0, exception);
+    JSObjectSetProperty(ctx, result, HyperloopInternString("available"), JSValueMakeNumber(ctx, pool.available), 0, exception);
+    JSObjectSetProperty(ctx, result, HyperloopInternString("inUse"), JSValueMakeNumber(ctx, pool.inUse), 0, exception);
+    JSObjectSetProperty(ctx, result, HyperloopInternString("highWater"), JSValueMakeNumber(ctx, pool.highWater), 0, exception);
+    JSObjectSetProperty(ctx, result, HyperloopInternString("created"), JSValueMakeNumber(ctx, pool.created), 0, exception);
+    JSObjectSetProperty(ctx, result, HyperloopInternString("reused"), JSValueMakeNumber(ctx, pool.reused), 0, exception);
+    JSObjectSetProperty(ctx, result, HyperloopInternString("discarded"), JSValueMakeNumber(ctx, pool.discarded), 0, exception);
+    return result;
+}
+
+/**
+ * return {hits, misses} of the native wrapper cache
+ */
+static JSValueRef WrapperCacheStats(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception)
+{
+    size_t hits, misses;
+    HyperloopWrapperCacheStats(&hits, &misses);
+    auto result = JSObjectMake(ctx, 0, 0);
+    JSObjectSetProperty(ctx, result, HyperloopInternString("hits"), JSValueMakeNumber(ctx, hits), 0, exception);
+    JSObjectSetProperty(ctx, result, HyperloopInternString("misses"), JSValueMakeNumber(ctx, misses), 0, exception);
+    return result;
+}
+
+/**
+ * return the require resolution cache hit and miss counts and its size
+ */
+static JSValueRef ResolveCacheStats(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception)
+{
+    size_t hits, misses, size;
+    HyperloopResolveCacheStats(&hits, &misses, &size);
+    auto result = JSObjectMake(ctx, 0, 0);
+    JSObjectSetProperty(ctx, result, HyperloopInternString("hits"), JSValueMakeNumber(ctx, hits), 0, exception);
+    JSObjectSetProperty(ctx, result, HyperloopInternString("misses"), JSValueMakeNumber(ctx, misses), 0, exception);
+    JSObjectSetProperty(ctx, result, HyperloopInternString("size"), JSValueMakeNumber(ctx, size), 0, exception);
+    return result;
+}
+
+/**
+ * return how many embedded sources were taken prefetched, decoded on demand
+ * and prefetched but not taken yet
+ */
+static JSValueRef PrefetchStats(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception)
+{
+    size_t prefetched, decoded, ready;
+    HyperloopPrefetchStats(&prefetched, &decoded, &ready);
+    auto result = JSObjectMake(ctx, 0, 0);
+    JSObjectSetProperty(ctx, result, HyperloopInternString("prefetched"), JSValueMakeNumber(ctx, prefetched), 0, exception);
+    JSObjectSetProperty(ctx, result, HyperloopInternString("decoded"), JSValueMakeNumber(ctx, decoded), 0, exception);
+    JSObjectSetProperty(ctx, result, HyperloopInternString("ready"), JSValueMakeNumber(ctx, ready), 0, exception);
+    return result;
+}
+
+/**
+ * return the module loader events recorded when built with HL_MODULE_STATS
+ */
+static JSValueRef ModuleStats(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception)
+{
+    static const char *types[] = { "resolve", "load", "decode", "evaluate", "prefetch" };
+    auto count = HyperloopModuleStatsCount();
+    std::vector<JSValueRef> events;
+    events.reserve(count);
+    HyperloopModuleEvent event;
+    for (size_t c = 0; c < count && HyperloopModuleStatsGet(c, &event); c++)
+    {
+        auto object = JSObjectMake(ctx, 0, 0);
+        JSObjectSetProperty(ctx, object, HyperloopInternString("type"), HyperloopMakeString(ctx, types[event.type], exception), 0, exception);
+        JSObjectSetProperty(ctx, object, HyperloopInternString("path"), HyperloopMakeString(ctx, event.path, exception), 0, exception);
+        JSObjectSetProperty(ctx, object, HyperloopInternString("parent"), HyperloopMakeString(ctx, event.parent, exception), 0, exception);
+        JSObjectSetProperty(ctx, object, HyperloopInternString("request"), HyperloopMakeString(ctx, event.request, exception), 0, exception);
+        JSObjectSetProperty(ctx, object, HyperloopInternString("cache"), HyperloopMakeString(ctx, event.cache, exception), 0, exception);
+        JSObjectSetProperty(ctx, object, HyperloopInternString("start"), JSValueMakeNumber(ctx, event.start), 0, exception);
+        JSObjectSetProperty(ctx, object, HyperloopInternString("duration"), JSValueMakeNumber(ctx, event.duration), 0, exception);
+        JSObjectSetProperty(ctx, object, HyperloopInternString("thread"), JSValueMakeNumber(ctx, event.thread), 0, exception);
+        events.push_back(object);
+    }
+    return JSObjectMakeArray(ctx, events.size(), events.data(), exception);
+}
+
 /**
  * internal 
  *
@@ -172,6 +406,24 @@ static void InitializeContext (JSGlobalContextRef ctx)
     auto vmBindingObject = JSObjectMake(ctx, 0, 0);
     auto vmrunInNewContextFunction = JSObjectMakeFunctionWithCallback(ctx, vmrunInNewContextProperty, RunInNewContext);
     JSObjectSetProperty(ctx, vmBindingObject, vmrunInNewContextProperty, vmrunInNewContextFunction, setterProps, 0);
+    auto vmSetContextPoolSizeProperty = HyperloopInternString("setContextPoolSize");
+    auto vmSetContextPoolSizeFunction = JSObjectMakeFunctionWithCallback(ctx, vmSetContextPoolSizeProperty, SetContextPoolSize);
+    JSObjectSetProperty(ctx, vmBindingObject, vmSetContextPoolSizeProperty, vmSetContextPoolSizeFunction, setterProps, 0);
+    auto vmContextPoolStatsProperty = HyperloopInternString("contextPoolStats");
+    auto vmContextPoolStatsFunction = JSObjectMakeFunctionWithCallback(ctx, vmContextPoolStatsProperty, ContextPoolStats);
+    JSObjectSetProperty(ctx, vmBindingObject, vmContextPoolStatsProperty, vmContextPoolStatsFunction, setterProps, 0);
+    auto vmWrapperCacheStatsProperty = HyperloopInternString("wrapperCacheStats");
+    auto vmWrapperCacheStatsFunction = JSObjectMakeFunctionWithCallback(ctx, vmWrapperCacheStatsProperty, WrapperCacheStats);
+    JSObjectSetProperty(ctx, vmBindingObject, vmWrapperCacheStatsProperty, vmWrapperCacheStatsFunction, setterProps, 0);
+    auto vmResolveCacheStatsProperty = HyperloopInternString("resolveCacheStats");
+    auto vmResolveCacheStatsFunction = JSObjectMakeFunctionWithCallback(ctx, vmResolveCacheStatsProperty, ResolveCacheStats);
+    JSObjectSetProperty(ctx, vmBindingObject, vmResolveCacheStatsProperty, vmResolveCacheStatsFunction, setterProps, 0);
+    auto vmPrefetchStatsProperty = HyperloopInternString("prefetchStats");
+    auto vmPrefetchStatsFunction = JSObjectMakeFunctionWithCallback(ctx, vmPrefetchStatsProperty, PrefetchStats);
+    JSObjectSetProperty(ctx, vmBindingObject, vmPrefetchStatsProperty, vmPrefetchStatsFunction, setterProps, 0);
+    auto vmModuleStatsProperty = HyperloopInternString("moduleStats");
+    auto vmModuleStatsFunction = JSObjectMakeFunctionWithCallback(ctx, vmModuleStatsProperty, ModuleStats);
+    JSObjectSetProperty(ctx, vmBindingObject, vmModuleStatsProperty, vmModuleStatsFunction, setterProps, 0);
     JSObjectSetProperty(ctx, global, vmBindingProperty, vmBindingObject, setterProps, 0);
     JSStringRelease(vmBindingProperty);
     JSStringRelease(vmrunInNewContextProperty);
@@ -248,6 +500,26 @@ EXPORTAPI JSGlobalContextRef InitializeHyperloop()
  */
 EXPORTAPI void DestroyHyperloop()
 {
+    // everything logged by the context goes out before it does
+    HyperloopLogFlush();
+    {
+        // the weak maps belong to the context going away
+        auto &cache = GetWrapperCache();
+        std::lock_guard<std::mutex> lock(cache.mutex);
+#if HL_WRAPPER_CACHE
+        cache.maps.clear();
+#endif
+    }
+    HyperloopResolveCacheClear();
+    HyperloopPrefetchStop();
+#if !HL_JSVALUE_IS_ARRAY
+    if (isArrayFunctionRef)
+    {
+        JSValueUnprotect(globalContextRef, isArrayFunctionRef);
+        isArrayFunctionRef = nullptr;
+    }
+#endif
+    DrainContextPool();
     if (globalContextRef) 
     {
         JSGlobalContextRelease(globalContextRef);
@@ -302,6 +574,78 @@ EXPORTAPI char * HyperloopJSValueToStringCopy(JSContextRef ctx, JSValueRef value
     return buf;
 }
 
+/**
+ * return the number of bytes str takes as UTF-8, unpaired surrogates count as
+ * the 3 byte replacement character
+ */
+static size_t UTF8Length(JSStringRef str)
+{
+    auto chars = JSStringGetCharactersPtr(str);
+    auto count = JSStringGetLength(str);
+    size_t length = 0;
+    for (size_t c = 0; c < count; c++)
+    {
+        auto ch = chars[c];
+        if (ch < 0x80)
+        {
+            length += 1;
+        }
+        else if (ch < 0x800)
+        {
+            length += 2;
+        }
+        else if (ch >= 0xD800 && ch <= 0xDBFF && c + 1 < count && chars[c + 1] >= 0xDC00 && chars[c + 1] <= 0xDFFF)
+        {
+            length += 4;
+            c++;
+        }
+        else
+        {
+            length += 3;
+        }
+    }
+    return length;
+}
+
+/**
+ * write str as UTF-8 into buffer and return its exact length
+ */
+EXPORTAPI size_t HyperloopJSStringGetUTF8(JSStringRef str, char *buffer, size_t size)
+{
+    if (size > 0 && JSStringGetMaximumUTF8CStringSize(str) <= size)
+    {
+        // the worst case fits, JSC tells us how much it wrote
+        auto written = JSStringGetUTF8CString(str, buffer, size);
+        return written ? written - 1 : 0;
+    }
+    auto length = UTF8Length(str);
+    if (length < size)
+    {
+        auto written = JSStringGetUTF8CString(str, buffer, size);
+        return written ? written - 1 : 0;
+    }
+    return length;
+}
+
+/**
+ * write value converted to a string as UTF-8 into buffer and return its exact length
+ */
+EXPORTAPI size_t HyperloopJSValueGetUTF8(JSContextRef ctx, JSValueRef value, char *buffer, size_t size, JSValueRef *exception)
+{
+    auto str = JSValueToStringCopy(ctx, value, exception);
+    if (str == nullptr)
+    {
+        if (size > 0)
+        {
+            buffer[0] = '\0';
+        }
+        return 0;
+    }
+    auto length = HyperloopJSStringGetUTF8(str, buffer, size);
+    JSStringRelease(str);
+    return length;
+}
+
 /**
  * return a char* from a JSStringRef as string which must be delete when finished
  */
@@ -324,21 +668,218 @@ EXPORTAPI JSValueRef HyperloopMakeString(JSContextRef ctx, const char *string, J
     return result;
 }
 
+/**
+ * return an interned JS string. JSStrings aren't bound to a context so the
+ * table is shared process wide and its strings are never released
+ */
+EXPORTAPI JSStringRef HyperloopInternString(const char *string)
+{
+    static std::mutex mutex;
+    static std::unordered_map<std::string, JSStringRef> table;
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = table.find(string);
+    if (found != table.end())
+    {
+        return found->second;
+    }
+    auto stringRef = JSStringCreateWithUTF8CString(string);
+    table.emplace(string, stringRef);
+    return stringRef;
+}
+
+/**
+ * internal
+ *
+ * intern all of the well known property names
+ */
+static JSStringRef * CreateWellKnownStrings()
+{
+    static JSStringRef strings[kHyperloopStringCount];
+#define HYPERLOOP_STRING_INTERN(name) strings[kHyperloopString_##name] = HyperloopInternString(#name);
+    HYPERLOOP_WELL_KNOWN_STRINGS(HYPERLOOP_STRING_INTERN)
+#undef HYPERLOOP_STRING_INTERN
+    return strings;
+}
+
+/**
+ * return the interned JS string for a well known property name
+ */
+EXPORTAPI JSStringRef HyperloopWellKnownString(HyperloopStringName name)
+{
+    static auto strings = CreateWellKnownStrings();
+    return strings[name];
+}
+
+/**
+ * return a JS string decoded from XOR obfuscated base64 or LZ4 compressed
+ * embedded source
+ */
+EXPORTAPI JSStringRef HyperloopDecodeEmbedString(const char *encoded, size_t length, unsigned char key)
+{
+    static_assert(sizeof(JSChar) == sizeof(unsigned short), "JSChar must be a UTF-16 code unit");
+    auto compressed = lz4_embed_compressed(encoded, length, key);
+    auto size = compressed ? lz4_embed_decoded_length(encoded, length, key) + 1 : (length / 4 + 1) * 3;
+    auto buf = new JSChar[size];
+    auto count = compressed ?
+        lz4_embed_decode_utf16(encoded, length, key, reinterpret_cast<unsigned short *>(buf)) :
+        base64_decode_utf16(encoded, length, key, reinterpret_cast<unsigned short *>(buf));
+    auto string = JSStringCreateWithCharacters(buf, count);
+    memset(buf, 0, size * sizeof(JSChar));
+    delete [] buf;
+    return string;
+}
+
+/**
+ * return a JS string for a source embedded as UTF-16. characters must live as
+ * long as the process
+ */
+EXPORTAPI JSStringRef HyperloopCreateEmbedString(const JSChar *characters, size_t length)
+{
+#if HL_STRING_NOCOPY
+    return JSStringCreateWithCharactersNoCopy(characters, length);
+#else
+    return JSStringCreateWithCharacters(characters, length);
+#endif
+}
+
 /**
  * return a void pointer
  */
 EXPORTAPI JSObjectRef HyperloopVoidPointerToJSValue(JSContextRef ctx, void *pointer, JSValueRef *exception)
 {
-    static JSClassRef ref = nullptr;
-    if (ref==nullptr)
+    if (voidPointerClassRef==nullptr)
     {
         JSClassDefinition def = kJSClassDefinitionEmpty;
         def.finalize = Finalizer;
         def.initialize = Initializer;
         def.className = "void *";
-        ref = JSClassCreate(&def);
+        voidPointerClassRef = JSClassCreate(&def);
+    }
+#if HL_WRAPPER_CACHE
+    auto cached = HyperloopWrapperCacheGet(ctx, pointer, voidPointerClassRef);
+    if (cached)
+    {
+        return cached;
+    }
+    auto object = JSObjectMake(ctx, voidPointerClassRef, new Hyperloop::NativeObject<void *>(pointer));
+    HyperloopWrapperCachePut(ctx, pointer, voidPointerClassRef, object);
+    return object;
+#else
+    return JSObjectMake(ctx, voidPointerClassRef, new Hyperloop::NativeObject<void *>(pointer));
+#endif
+}
+
+#if HL_WRAPPER_CACHE
+/**
+ * called when the global object owning a weak map goes away. the collector can
+ * run this from inside any JSC call, so the cache mutex is never held across one
+ */
+static void WrapperCacheMapDestroyed(JSWeakObjectMapRef map, void *data)
+{
+    auto &cache = GetWrapperCache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    auto it = cache.maps.find(static_cast<JSClassRef>(data));
+    if (it != cache.maps.end() && it->second == map)
+    {
+        cache.maps.erase(it);
+    }
+}
+
+/**
+ * return the weak map of class cls, creating it when create is true. maps
+ * belong to the hyperloop global context, so they outlive the contexts of
+ * hyperloop$vm.runInNewContext which share its context group
+ */
+static JSWeakObjectMapRef WrapperCacheMap(WrapperCache &cache, JSClassRef cls, bool create)
+{
+    {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        auto it = cache.maps.find(cls);
+        if (it != cache.maps.end())
+        {
+            return it->second;
+        }
+    }
+    if (!create)
+    {
+        return nullptr;
+    }
+    auto map = JSWeakObjectMapCreate(HyperloopGlobalContext(), cls, WrapperCacheMapDestroyed);
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    // another thread may have created one in the meantime, keep the first
+    return cache.maps.insert(std::make_pair(cls, map)).first->second;
+}
+#endif
+
+/**
+ * return the live JS wrapper of class cls for pointer
+ *
+ * the weak map stops returning an object once the collector has found it
+ * unreachable, even though its finalizer may not have run yet
+ */
+EXPORTAPI JSObjectRef HyperloopWrapperCacheGet(JSContextRef ctx, const void *pointer, JSClassRef cls)
+{
+    auto &cache = GetWrapperCache();
+    JSObjectRef object = nullptr;
+#if HL_WRAPPER_CACHE
+    auto map = WrapperCacheMap(cache, cls, false);
+    if (map)
+    {
+        object = JSWeakObjectMapGet(ctx, map, const_cast<void *>(pointer));
+    }
+#endif
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    if (object)
+    {
+        cache.hits++;
+    }
+    else
+    {
+        cache.misses++;
+    }
+    return object;
+}
+
+/**
+ * remember the JS wrapper of class cls for pointer
+ */
+EXPORTAPI void HyperloopWrapperCachePut(JSContextRef ctx, const void *pointer, JSClassRef cls, JSObjectRef object)
+{
+#if HL_WRAPPER_CACHE
+    JSWeakObjectMapSet(ctx, WrapperCacheMap(GetWrapperCache(), cls, true), const_cast<void *>(pointer), object);
+#endif
+}
+
+/**
+ * forget the JS wrapper of class cls for pointer. another wrapper may have
+ * replaced object in the meantime, that one is kept
+ */
+EXPORTAPI void HyperloopWrapperCacheRemove(JSContextRef ctx, const void *pointer, JSClassRef cls, JSObjectRef object)
+{
+#if HL_WRAPPER_CACHE
+    auto map = WrapperCacheMap(GetWrapperCache(), cls, false);
+    if (map && JSWeakObjectMapGet(ctx, map, const_cast<void *>(pointer)) == object)
+    {
+        JSWeakObjectMapRemove(ctx, map, const_cast<void *>(pointer));
+    }
+#endif
+}
+
+/**
+ * return the wrapper cache hit and miss counts
+ */
+EXPORTAPI void HyperloopWrapperCacheStats(size_t *hits, size_t *misses)
+{
+    auto &cache = GetWrapperCache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    if (hits)
+    {
+        *hits = cache.hits;
+    }
+    if (misses)
+    {
+        *misses = cache.misses;
     }
-    return JSObjectMake(ctx, ref, new Hyperloop::NativeObject<void *>(pointer));
 }
 
 /**
@@ -353,6 +894,77 @@ EXPORTAPI void* HyperloopJSValueToVoidPointer(JSContextRef ctx, JSValueRef value
     return po2->getObject();
 }
 
+#if HL_JSC_TYPED_ARRAY
+/**
+ * internal
+ *
+ * typed array views do not own the memory they alias, the pointer object does
+ */
+static void TypedArrayViewDeallocator(void *bytes, void *context)
+{
+}
+
+/**
+ * return a typed array aliasing the memory of a void pointer object
+ */
+EXPORTAPI JSObjectRef HyperloopMakeTypedArrayView(JSContextRef ctx, JSTypedArrayType type, JSObjectRef pointer, size_t byteLength, JSValueRef *exception)
+{
+    auto bytes = HyperloopJSValueToVoidPointer(ctx, pointer, exception);
+    if (bytes == nullptr)
+    {
+        *exception = HyperloopMakeException(ctx, "Can't convert memory");
+        return nullptr;
+    }
+    auto view = JSObjectMakeTypedArrayWithBytesNoCopy(ctx, type, bytes, byteLength, TypedArrayViewDeallocator, nullptr, exception);
+    if (view == nullptr)
+    {
+        return nullptr;
+    }
+    // the view holds its buffer, the buffer holds the pointer object
+    auto buffer = JSObjectGetTypedArrayBuffer(ctx, view, exception);
+    JSObjectSetProperty(ctx, buffer, HyperloopInternString("hyperloop$pointer"), pointer, kJSPropertyAttributeReadOnly | kJSPropertyAttributeDontEnum | kJSPropertyAttributeDontDelete, exception);
+    return view;
+}
+
+/**
+ * return a void pointer object to the contents of a typed array or array buffer
+ */
+EXPORTAPI JSObjectRef HyperloopTypedArrayToVoidPointer(JSContextRef ctx, JSValueRef value, size_t *byteLength, JSValueRef *exception)
+{
+    auto type = JSValueGetTypedArrayType(ctx, value, exception);
+    if (type == kJSTypedArrayTypeNone)
+    {
+        *exception = HyperloopMakeException(ctx, "Value is not a typed array");
+        return nullptr;
+    }
+    auto object = JSValueToObject(ctx, value, exception);
+    char *bytes = nullptr;
+    size_t length = 0;
+    if (type == kJSTypedArrayTypeArrayBuffer)
+    {
+        bytes = static_cast<char *>(JSObjectGetArrayBufferBytesPtr(ctx, object, exception));
+        length = JSObjectGetArrayBufferByteLength(ctx, object, exception);
+    }
+    else
+    {
+        bytes = static_cast<char *>(JSObjectGetTypedArrayBytesPtr(ctx, object, exception));
+        if (bytes != nullptr)
+        {
+            bytes += JSObjectGetTypedArrayByteOffset(ctx, object, exception);
+        }
+        length = JSObjectGetTypedArrayByteLength(ctx, object, exception);
+    }
+    if (byteLength)
+    {
+        *byteLength = length;
+    }
+    auto pointer = HyperloopVoidPointerToJSValue(ctx, bytes, exception);
+    // the pointer object holds the typed array so the bytes stay put
+    JSObjectSetProperty(ctx, pointer, HyperloopInternString("hyperloop$buffer"), object, kJSPropertyAttributeReadOnly | kJSPropertyAttributeDontEnum | kJSPropertyAttributeDontDelete, exception);
+    return pointer;
+}
+#endif
+
 /**
  * invoke a function callback
  */
@@ -367,41 +979,73 @@ EXPORTAPI JSValueRef HyperloopInvokeFunctionCallback (JSContextRef ctx, void * c
     return JSObjectCallAsFunction(HyperloopGlobalContext(), callbackObj, NULL, argumentCount, arguments, exception);
 }
 
+#if !HL_JSVALUE_IS_ARRAY
+/**
+ * internal
+ *
+ * resolve Array.isArray in the global object of ctx
+ */
+static JSObjectRef LookupIsArrayFunction(JSContextRef ctx)
+{
+    JSValueRef exception = nullptr;
+    JSObjectRef global = JSContextGetGlobalObject(ctx);
+    JSObjectRef array = JSValueToObject(ctx, JSObjectGetProperty(ctx, global, HyperloopWellKnownString(kHyperloopString_Array), &exception), &exception);
+    if (exception != nullptr)
+    {
+        return nullptr;
+    }
+    JSObjectRef isArray = JSValueToObject(ctx, JSObjectGetProperty(ctx, array, HyperloopWellKnownString(kHyperloopString_isArray), &exception), &exception);
+    if (exception != nullptr)
+    {
+        return nullptr;
+    }
+    return isArray;
+}
+#endif
+
 /*
  * Tests whether a JavaScript value is an array object
  * 
- * This invokes Array.isArray(value) and returns its result
+ * Uses JSValueIsArray when the linked JavaScriptCore has it, otherwise calls
+ * Array.isArray(value). The function is looked up once for the hyperloop global
+ * context and kept protected; other contexts look it up on each call.
  */
 EXPORTAPI bool HyperloopJSValueIsArray(JSContextRef ctx, JSValueRef value) 
 {
-    if (JSValueIsObject(ctx, value)) 
+#if HL_JSVALUE_IS_ARRAY
+    return JSValueIsArray(ctx, value);
+#else
+    if (!JSValueIsObject(ctx, value)) 
     {
-        JSObjectRef global = JSContextGetGlobalObject(ctx);
-        JSValueRef exception = JSValueMakeNull(ctx);
-        JSStringRef string = JSStringCreateWithUTF8CString("Array");
-        JSObjectRef array = JSValueToObject(ctx, JSObjectGetProperty(ctx, global, string, &exception), &exception);
-        JSStringRelease(string);
-        if (!JSValueIsNull(ctx, exception)) 
-        {
-            return false;
-        }
-
-        string = JSStringCreateWithUTF8CString("isArray");
-        JSObjectRef isArray = JSValueToObject(ctx, JSObjectGetProperty(ctx, array, string, &exception), &exception);
-        JSStringRelease(string);
-        if (!JSValueIsNull(ctx, exception))
-        {
-            return false;
-        }
-
-        JSValueRef result = JSObjectCallAsFunction(ctx, isArray, global, 1, &value, &exception);
+        return false;
+    }
 
-        if (JSValueIsNull(ctx, exception) && JSValueIsBoolean(ctx, result)) 
+    JSObjectRef isArray = nullptr;
+    if (globalContextRef && JSContextGetGlobalObject(ctx) == JSContextGetGlobalObject(globalContextRef))
+    {
+        if (!isArrayFunctionRef)
         {
-            return JSValueToBoolean(ctx, result);
+            isArrayFunctionRef = LookupIsArrayFunction(globalContextRef);
+            if (isArrayFunctionRef)
+            {
+                JSValueProtect(globalContextRef, isArrayFunctionRef);
+            }
         }
+        isArray = isArrayFunctionRef;
+    }
+    else
+    {
+        isArray = LookupIsArrayFunction(ctx);
+    }
+    if (!isArray)
+    {
+        return false;
     }
-    return false;
+
+    JSValueRef exception = nullptr;
+    JSValueRef result = JSObjectCallAsFunction(ctx, isArray, nullptr, 1, &value, &exception);
+    return exception == nullptr && JSValueIsBoolean(ctx, result) && JSValueToBoolean(ctx, result);
+#endif
 }
 
 #define MEMORY_SIZE_OF_FUNCTION_DEF(type) \
@@ -459,19 +1103,12 @@ EXPORTAPI JSValueRef Hyperloop_Memory_Set_##name (JSContextRef ctx, JSObjectRef
         auto value = static_cast<type>(JSValueToNumber(ctx, arguments[2], exception));\
         pointer[index] = value;\
     } else if (JSValueIsString(ctx, arguments[2])) {\
-        auto str = JSValueToStringCopy(ctx,arguments[2],exception);\
-        auto size = JSStringGetMaximumUTF8CStringSize(str);\
-        auto buf = new char[size];\
-        JSStringGetUTF8CString(str,buf,size);\
-        JSStringRelease(str);\
+        Hyperloop::StringBuffer str(ctx,arguments[2],exception);\
         pointer+=index;\
-        memcpy(pointer, buf, size);\
-        delete[] buf;\
+        memcpy(pointer, str.c_str(), str.size() + 1);\
     } else if (HyperloopJSValueIsArray(ctx, arguments[2])) {\
         auto jobj = JSValueToObject(ctx, arguments[2], exception);\
-        auto jstr = JSStringCreateWithUTF8CString("length");\
-        auto jlen = JSObjectGetProperty(ctx, jobj, jstr, exception);\
-        JSStringRelease(jstr);\
+        auto jlen = JSObjectGetProperty(ctx, jobj, HyperloopWellKnownString(kHyperloopString_length), exception);\
         if (JSValueIsNumber(ctx, jlen)) {\
             auto len = static_cast<size_t>(JSValueToNumber(ctx, jlen, exception));\
             for (size_t i = 0; i < len; i++) {\
@@ -520,6 +1157,71 @@ EXPORTAPI JSValueRef Hyperloop_Memory_Set_void (JSContextRef ctx, JSObjectRef fu
     return Hyperloop_Memory_Set_int(ctx, function, thisObject, argumentCount, arguments, exception);
 }
 
+/*
+ * typed array views over native memory
+ *
+ * Hyperloop_Memory_View_float(pointer, count) returns a Float32Array aliasing
+ * count floats at pointer and Hyperloop_Memory_Pointer(view) goes the other way
+ */
+#if HL_JSC_TYPED_ARRAY
+#define MEMORY_VIEW_FUNCTION_DEF(name, type, arrayType) \
+EXPORTAPI JSValueRef Hyperloop_Memory_View_##name (JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception)\
+{\
+    if (argumentCount < 2 || !JSValueIsObject(ctx, arguments[0]) || !JSValueIsNumber(ctx, arguments[1])) {\
+        *exception = HyperloopMakeException(ctx, "Wrong arguments passed to memory");\
+        return JSValueMakeUndefined(ctx);\
+    }\
+    auto pointer = JSValueToObject(ctx, arguments[0], exception);\
+    auto number = JSValueToNumber(ctx, arguments[1], exception);\
+    /* a count that isn't a whole number of elements the address space can hold would make a view of arbitrary memory */\
+    if (!std::isfinite(number) || number < 0 || number != std::floor(number) || number >= static_cast<double>(SIZE_MAX / sizeof(type))) {\
+        *exception = HyperloopMakeException(ctx, "Invalid count passed to memory");\
+        return JSValueMakeUndefined(ctx);\
+    }\
+    auto count = static_cast<size_t>(number);\
+    auto view = HyperloopMakeTypedArrayView(ctx, arrayType, pointer, count * sizeof(type), exception);\
+    if (view == nullptr) {\
+        return JSValueMakeUndefined(ctx);\
+    }\
+    return view;\
+}
+
+EXPORTAPI JSValueRef Hyperloop_Memory_Pointer (JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception)
+{
+    if (argumentCount < 1) {
+        *exception = HyperloopMakeException(ctx, "Wrong arguments passed to memory");
+        return JSValueMakeUndefined(ctx);
+    }
+    auto pointer = HyperloopTypedArrayToVoidPointer(ctx, arguments[0], nullptr, exception);
+    if (pointer == nullptr) {
+        return JSValueMakeUndefined(ctx);
+    }
+    return pointer;
+}
+#else
+#define MEMORY_VIEW_FUNCTION_DEF(name, type, arrayType) \
+EXPORTAPI JSValueRef Hyperloop_Memory_View_##name (JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception)\
+{\
+    *exception = HyperloopMakeException(ctx, "Typed arrays are not supported by this JavaScriptCore");\
+    return JSValueMakeUndefined(ctx);\
+}
+
+EXPORTAPI JSValueRef Hyperloop_Memory_Pointer (JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception)
+{
+    *exception = HyperloopMakeException(ctx, "Typed arrays are not supported by this JavaScriptCore");
+    return JSValueMakeUndefined(ctx);
+}
+#endif
+
+MEMORY_VIEW_FUNCTION_DEF(float, float, kJSTypedArrayTypeFloat32Array)
+MEMORY_VIEW_FUNCTION_DEF(double, double, kJSTypedArrayTypeFloat64Array)
+MEMORY_VIEW_FUNCTION_DEF(int, int, kJSTypedArrayTypeInt32Array)
+MEMORY_VIEW_FUNCTION_DEF(uint, unsigned int, kJSTypedArrayTypeUint32Array)
+MEMORY_VIEW_FUNCTION_DEF(short, short, kJSTypedArrayTypeInt16Array)
+MEMORY_VIEW_FUNCTION_DEF(ushort, unsigned short, kJSTypedArrayTypeUint16Array)
+MEMORY_VIEW_FUNCTION_DEF(char, char, kJSTypedArrayTypeInt8Array)
+MEMORY_VIEW_FUNCTION_DEF(uchar, unsigned char, kJSTypedArrayTypeUint8Array)
+
 
 EXPORTAPI JSValueRef Hyperloop_Binary_IsStrictEqual(JSContextRef ctx, JSObjectRef function, JSObjectRef thisObject, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception) {
     if (argumentCount < 2)
@@ -28,9 +28,44 @@
 #endif
 #endif
 
+/**
+ * JavaScriptCore has a native array test (JSValueIsArray) and the typed array
+ * API (JSTypedArray.h) in the same releases that introduced JSC_API_AVAILABLE.
+ * define HL_JSVALUE_IS_ARRAY or HL_JSC_TYPED_ARRAY to 0 or 1 to override the
+ * detection for a particular JavaScriptCore build.
+ */
+#if defined(JSC_API_AVAILABLE) && !defined(USE_TIJSCORE)
+#define HL_JSC_MODERN_API 1
+#else
+#define HL_JSC_MODERN_API 0
+#endif
+
+#ifndef HL_JSVALUE_IS_ARRAY
+#define HL_JSVALUE_IS_ARRAY HL_JSC_MODERN_API
+#endif
+
+#ifndef HL_JSC_TYPED_ARRAY
+#define HL_JSC_TYPED_ARRAY HL_JSC_MODERN_API
+#endif
+
+#if HL_JSC_TYPED_ARRAY && !defined(HYPERLOOP_EXCLUDE_JSCORE_IMPORT) && !defined(HL_IOS)
+#include <JavaScriptCore/JSTypedArray.h>
+#endif
+
 #include <string> //TODO: refactor to remove c++ from API
 #include <cmath>
 #include <stdlib.h> 
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <new>
+
+// the compiler prepends the object pool when it merges the headers, a copy of
+// this header on its own picks it up from next to it
+#ifndef __HYPERLOOP_OBJECTPOOL_HEADER__
+#include "_objectpool.h"
+#endif
 
 #define EXPORTAPI extern "C"
 
@@ -84,11 +119,192 @@ EXPORTAPI char * HyperloopJSValueToStringCopy(JSContextRef ctx, JSValueRef value
  */
 EXPORTAPI char * HyperloopJSStringToStringCopy(JSContextRef ctx, JSStringRef str, JSValueRef *exception);
 
+/**
+ * write str as a NUL terminated UTF-8 string into buffer, which holds size bytes,
+ * and return its length in bytes without the NUL. like snprintf, when the
+ * result is size or more the buffer was too small and the caller should retry
+ * with result + 1 bytes
+ */
+EXPORTAPI size_t HyperloopJSStringGetUTF8(JSStringRef str, char *buffer, size_t size);
+
+/**
+ * write value converted to a string into buffer, see HyperloopJSStringGetUTF8
+ */
+EXPORTAPI size_t HyperloopJSValueGetUTF8(JSContextRef ctx, JSValueRef value, char *buffer, size_t size, JSValueRef *exception);
+
 /**
  * return a JS string from a const char *
  */
 EXPORTAPI JSValueRef HyperloopMakeString(JSContextRef ctx, const char *string, JSValueRef *exception);
 
+/**
+ * property names which are interned at startup and shared process wide
+ */
+#define HYPERLOOP_WELL_KNOWN_STRINGS(V) \
+    V(length) \
+    V(Array) \
+    V(isArray) \
+    V(module) \
+    V(exports) \
+    V(__filename) \
+    V(__dirname) \
+    V(require) \
+    V(code) \
+    V(main) \
+    V(Function) \
+    V(prototype)
+
+#define HYPERLOOP_STRING_ENUM(name) kHyperloopString_##name,
+enum HyperloopStringName
+{
+    HYPERLOOP_WELL_KNOWN_STRINGS(HYPERLOOP_STRING_ENUM)
+    kHyperloopStringCount
+};
+#undef HYPERLOOP_STRING_ENUM
+
+/**
+ * return an interned JS string for string. the string is owned by hyperloop,
+ * lives for the life of the process and must not be released
+ */
+EXPORTAPI JSStringRef HyperloopInternString(const char *string);
+
+/**
+ * return the interned JS string for a well known property name
+ */
+EXPORTAPI JSStringRef HyperloopWellKnownString(HyperloopStringName name);
+
+/**
+ * return a JS string decoded from XOR obfuscated base64 or LZ4 compressed
+ * embedded source
+ */
+EXPORTAPI JSStringRef HyperloopDecodeEmbedString(const char *encoded, size_t length, unsigned char key);
+
+/**
+ * when HL_STRING_NOCOPY is 1, strings for sources embedded as UTF-16 reference
+ * the embedded characters instead of copying them. it needs
+ * JSStringCreateWithCharactersNoCopy, which JavaScriptCore exports but only
+ * declares in its private headers
+ */
+#ifndef HL_STRING_NOCOPY
+#define HL_STRING_NOCOPY 0
+#endif
+
+#if HL_STRING_NOCOPY
+/**
+ * JavaScriptCore private API (JSStringRefPrivate.h)
+ */
+extern "C" JSStringRef JSStringCreateWithCharactersNoCopy(const JSChar *chars, size_t numChars);
+#endif
+
+/**
+ * return a JS string for a source embedded as UTF-16. characters must live as
+ * long as the process
+ */
+EXPORTAPI JSStringRef HyperloopCreateEmbedString(const JSChar *characters, size_t length);
+
+/**
+ * embedded sources are decoded ahead of their require() by a pool of
+ * background threads unless HL_PREFETCH is defined to 0
+ */
+#ifndef HL_PREFETCH
+#define HL_PREFETCH 1
+#endif
+
+/**
+ * an embedded source in the dependency graph the compiler emits: its path, its
+ * encoded bytes (nullptr for compiled modules) and the indexes in the same
+ * table of the sources it requires
+ */
+struct HyperloopPrefetchEntry
+{
+    const char *path;
+    const char *encoded;
+    size_t length;
+    const size_t *dependencies;
+    size_t dependencyCount;
+};
+
+/**
+ * called by a translation unit to register its dependency graph. the table is
+ * referenced, not copied
+ */
+EXPORTAPI bool HyperloopRegisterPrefetchGraph(const HyperloopPrefetchEntry *entries, size_t count, unsigned char key);
+
+/**
+ * start decoding the sources path transitively requires in the background
+ */
+EXPORTAPI void HyperloopPrefetchStart(const char *path);
+
+/**
+ * stop the background decoding and release what was never taken
+ */
+EXPORTAPI void HyperloopPrefetchStop();
+
+/**
+ * return the decoded embedded source, prefetched when it was, otherwise
+ * decoded now like HyperloopDecodeEmbedString
+ */
+EXPORTAPI JSStringRef HyperloopTakeEmbedString(const char *encoded, size_t length, unsigned char key);
+
+/**
+ * return the sources taken already decoded, the ones decoded on demand and
+ * the ones decoded in the background and still waiting to be taken
+ */
+EXPORTAPI void HyperloopPrefetchStats(size_t *prefetched, size_t *decoded, size_t *ready);
+
+/**
+ * when HL_WRAPPER_CACHE is 1, converting the same native pointer to JS again
+ * returns the JS object already wrapping it as long as that object is alive.
+ * entries live in JSC weak object maps, which drop an object when the
+ * collector finds it unreachable rather than when it is swept
+ */
+#ifndef HL_WRAPPER_CACHE
+#define HL_WRAPPER_CACHE 0
+#endif
+
+#if HL_WRAPPER_CACHE
+/**
+ * JavaScriptCore private weak object map API (JSWeakObjectMapRefPrivate.h)
+ */
+extern "C" {
+typedef struct OpaqueJSWeakObjectMap* JSWeakObjectMapRef;
+typedef void (*JSWeakMapDestroyedCallback)(JSWeakObjectMapRef map, void* data);
+JSWeakObjectMapRef JSWeakObjectMapCreate(JSContextRef ctx, void* data, JSWeakMapDestroyedCallback destructor);
+void JSWeakObjectMapSet(JSContextRef ctx, JSWeakObjectMapRef map, void* key, JSObjectRef object);
+JSObjectRef JSWeakObjectMapGet(JSContextRef ctx, JSWeakObjectMapRef map, void* key);
+void JSWeakObjectMapRemove(JSContextRef ctx, JSWeakObjectMapRef map, void* key);
+}
+#endif
+
+/**
+ * return the live JS wrapper of class cls for pointer or nullptr
+ */
+EXPORTAPI JSObjectRef HyperloopWrapperCacheGet(JSContextRef ctx, const void *pointer, JSClassRef cls);
+
+/**
+ * remember object as the JS wrapper of class cls for pointer
+ */
+EXPORTAPI void HyperloopWrapperCachePut(JSContextRef ctx, const void *pointer, JSClassRef cls, JSObjectRef object);
+
+/**
+ * forget the wrapper of class cls for pointer if it is object
+ */
+EXPORTAPI void HyperloopWrapperCacheRemove(JSContextRef ctx, const void *pointer, JSClassRef cls, JSObjectRef object);
+
+/**
+ * return the wrapper cache lookups that found a wrapper and the ones that did not
+ */
+EXPORTAPI void HyperloopWrapperCacheStats(size_t *hits, size_t *misses);
+
+/**
+ * return the wrapper cache key of a native pointer, object or block
+ */
+template <typename T>
+inline const void* HyperloopWrapperKey(T value)
+{
+    return reinterpret_cast<const void *>((uintptr_t)value);
+}
+
 /**
  * return a void pointer as a JSValueRef
  */
@@ -99,6 +315,21 @@ EXPORTAPI JSObjectRef HyperloopVoidPointerToJSValue(JSContextRef ctx, void *poin
  */
 EXPORTAPI void* HyperloopJSValueToVoidPointer(JSContextRef ctx, JSValueRef value, JSValueRef *exception);
 
+#if HL_JSC_TYPED_ARRAY
+/**
+ * return a typed array of type that aliases byteLength bytes of the memory held
+ * by the void pointer object pointer. the memory is not copied and the pointer
+ * object is kept alive for as long as the view's buffer is reachable
+ */
+EXPORTAPI JSObjectRef HyperloopMakeTypedArrayView(JSContextRef ctx, JSTypedArrayType type, JSObjectRef pointer, size_t byteLength, JSValueRef *exception);
+
+/**
+ * return the first byte of a typed array's contents as a void pointer object that
+ * keeps the typed array alive. byteLength is set to the size of the view
+ */
+EXPORTAPI JSObjectRef HyperloopTypedArrayToVoidPointer(JSContextRef ctx, JSValueRef value, size_t *byteLength, JSValueRef *exception);
+#endif
+
 /**
  * invoke a function callback
  */
@@ -109,6 +340,12 @@ EXPORTAPI JSValueRef HyperloopInvokeFunctionCallback (JSContextRef ctx, void * c
  */
 EXPORTAPI JSObjectRef HyperloopCreateModule(JSGlobalContextRef ctx, JSObjectRef parent, const char *filename, const char *dirname, JSValueRef *exception);
 
+/**
+ * evaluate the source of a module in a CommonJS function wrapper called with
+ * the module's exports, require, module, __filename and __dirname
+ */
+EXPORTAPI JSValueRef HyperloopEvaluateModule(JSGlobalContextRef ctx, JSObjectRef module, JSStringRef source, JSStringRef sourceURL, JSValueRef *exception);
+
 /**
  * called when the module has completed loading
  */
@@ -148,6 +385,220 @@ typedef JSValueRef (*HyperloopTranslationUnitCallback)(JSGlobalContextRef ctx, c
  */
 EXPORTAPI bool HyperloopRegisterTranslationUnit(HyperloopTranslationUnitCallback callback, size_t count, ...);
 
+/**
+ * forget every memoized require resolution
+ */
+EXPORTAPI void HyperloopResolveCacheClear();
+
+/**
+ * return the require resolutions answered from the cache, the ones that were
+ * not and the number of (dirname, request) pairs cached
+ */
+EXPORTAPI void HyperloopResolveCacheStats(size_t *hits, size_t *misses, size_t *size);
+
+/**
+ * a source path embedded in a translation unit with its length and
+ * HyperloopPathHash, precomputed by the compiler
+ */
+struct HyperloopTranslationUnitEntry
+{
+    const char *path;
+    size_t length;
+    uint32_t hash;
+};
+
+/**
+ * called by a translation unit to register its compiled code with a static
+ * table of its sources. the table is referenced, not copied
+ */
+EXPORTAPI bool HyperloopRegisterTranslationUnitIndex(HyperloopTranslationUnitCallback callback, const HyperloopTranslationUnitEntry *entries, size_t count);
+
+/**
+ * set the directory that relative source pack filenames are found in. the
+ * default is the working directory. the pack is mapped by
+ * HyperloopInitialize_*, so this must be called before it
+ */
+EXPORTAPI void HyperloopSetSourcePackDirectory(const char *directory);
+
+/**
+ * called by a translation unit to memory map the source pack holding its
+ * sources and register them with callback. false when the pack is missing or
+ * malformed
+ */
+EXPORTAPI bool HyperloopRegisterSourcePack(HyperloopTranslationUnitCallback callback, const char *filename, unsigned char key);
+
+/**
+ * load path from a registered source pack. returns nullptr when no pack has it
+ */
+EXPORTAPI JSValueRef HyperloopLoadSourcePack(JSGlobalContextRef ctx, const JSObjectRef & parent, const char *path, JSValueRef *exception);
+
+/**
+ * 32-bit FNV-1a hash of a source path, the compiler computes the same
+ */
+inline uint32_t HyperloopPathHash(const char *path, size_t length, uint32_t hash = 2166136261u)
+{
+    for (size_t c = 0; c < length; c++)
+    {
+        hash ^= static_cast<unsigned char>(path[c]);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * hash of the (dirname, request) key of a require table entry
+ */
+inline uint32_t HyperloopRequireHash(const char *dirname, size_t dirnameLength, const char *request, size_t requestLength)
+{
+    return HyperloopPathHash(request, requestLength, HyperloopPathHash("", 1, HyperloopPathHash(dirname, dirnameLength)));
+}
+
+/**
+ * a require of request from a module in dirname that the compiler resolved to
+ * path, with HyperloopRequireHash of the key
+ */
+struct HyperloopRequireEntry
+{
+    const char *dirname;
+    const char *request;
+    const char *path;
+    size_t length;
+    uint32_t hash;
+};
+
+/**
+ * called by a translation unit to register the requires it resolved at build
+ * time. the table is referenced, not copied
+ */
+EXPORTAPI bool HyperloopRegisterRequireTable(const HyperloopRequireEntry *entries, size_t count);
+
+/**
+ * a package directory embedded in a translation unit with HyperloopPathHash of
+ * it and the path its package.json main resolves to, nullptr without a main
+ */
+struct HyperloopPackageMainEntry
+{
+    const char *directory;
+    size_t length;
+    uint32_t hash;
+    const char *main;
+    size_t mainLength;
+};
+
+/**
+ * called by a translation unit to register the package.json main of the
+ * packages it embeds. the table is referenced, not copied
+ */
+EXPORTAPI bool HyperloopRegisterPackageMainTable(const HyperloopPackageMainEntry *entries, size_t count);
+
+/**
+ * when HL_MODULE_STATS is 1 the module loader records how long every require
+ * spends resolving, decoding and evaluating. it costs nothing when it is 0
+ */
+#ifndef HL_MODULE_STATS
+#define HL_MODULE_STATS 0
+#endif
+
+enum HyperloopModuleEventType
+{
+    HyperloopModuleEventResolve,
+    HyperloopModuleEventLoad,
+    HyperloopModuleEventDecode,
+    HyperloopModuleEventEvaluate,
+    HyperloopModuleEventPrefetch
+};
+
+/**
+ * one timed step of loading a module. path is the module, parent the module
+ * that required it. request and cache are only set for resolve steps, cache
+ * also for decode steps. times are microseconds since the first event
+ */
+struct HyperloopModuleEvent
+{
+    HyperloopModuleEventType type;
+    const char *path;
+    const char *parent;
+    const char *request;
+    const char *cache;
+    double start;
+    double duration;
+    unsigned thread;
+};
+
+/**
+ * record a step that started at start (HyperloopModuleStatsNow) and ends now
+ */
+EXPORTAPI void HyperloopModuleStatsRecord(HyperloopModuleEventType type, const char *path, const char *parent, const char *request, const char *cache, double start);
+
+/**
+ * microseconds since the first module event
+ */
+EXPORTAPI double HyperloopModuleStatsNow();
+
+/**
+ * the module being loaded on this thread, the parent of what it requires
+ */
+EXPORTAPI const char* HyperloopModuleStatsCurrent();
+EXPORTAPI void HyperloopModuleStatsPush(const char *path);
+EXPORTAPI void HyperloopModuleStatsPop();
+
+/**
+ * return the number of recorded events
+ */
+EXPORTAPI size_t HyperloopModuleStatsCount();
+
+/**
+ * copy event index into event, its strings stay valid until HyperloopModuleStatsReset
+ */
+EXPORTAPI bool HyperloopModuleStatsGet(size_t index, HyperloopModuleEvent *event);
+
+/**
+ * forget every recorded event
+ */
+EXPORTAPI void HyperloopModuleStatsReset();
+
+/**
+ * write the recorded events to filename as Chrome trace_event JSON
+ */
+EXPORTAPI bool HyperloopModuleStatsWriteTrace(const char *filename);
+
+/**
+ * console.log output goes through a ring buffer drained by a background thread
+ * unless HL_ASYNC_LOG is defined to 0
+ */
+#ifndef HL_ASYNC_LOG
+#define HL_ASYNC_LOG 1
+#endif
+
+/**
+ * what HyperloopLog does when the log ring buffer is full
+ */
+enum HyperloopLogOverflowPolicy
+{
+    HyperloopLogOverflowDrop,   // discard the message and count it
+    HyperloopLogOverflowBlock   // wait for the background thread to make room
+};
+
+/**
+ * queue a NUL terminated message of length bytes for HyperloopNativeLogger
+ */
+EXPORTAPI void HyperloopLog(const char *message, size_t length);
+
+/**
+ * block until every queued message has been passed to HyperloopNativeLogger
+ */
+EXPORTAPI void HyperloopLogFlush();
+
+/**
+ * set the policy for messages logged while the ring buffer is full
+ */
+EXPORTAPI void HyperloopSetLogOverflowPolicy(HyperloopLogOverflowPolicy policy);
+
+/**
+ * return the number of messages dropped because the ring buffer was full
+ */
+EXPORTAPI size_t HyperloopLogDroppedCount();
+
 ///////////////////////////////////////////////////////////////////////////////
 // Platforms implement
 ///////////////////////////////////////////////////////////////////////////////
@@ -162,15 +613,114 @@ EXPORTAPI void HyperloopNativeLogger(const char *str);
 namespace Hyperloop
 {
 
+/**
+ * UTF-8 copy of a JS string held inline when it is short and on the heap
+ * otherwise. use instead of HyperloopJSValueToStringCopy when the string is
+ * only needed for the current scope
+ */
+class StringBuffer
+{
+public:
+    static const size_t InlineSize = 256;
+
+    StringBuffer()
+        : buffer{storage}, length{0}
+    {
+        storage[0] = '\0';
+    }
+
+    StringBuffer(JSContextRef ctx, JSValueRef value, JSValueRef *exception)
+        : buffer{storage}, length{0}
+    {
+        storage[0] = '\0';
+        assign(ctx, value, exception);
+    }
+
+    explicit StringBuffer(JSStringRef str)
+        : buffer{storage}, length{0}
+    {
+        storage[0] = '\0';
+        assign(str);
+    }
+
+    ~StringBuffer()
+    {
+        if (buffer != storage)
+        {
+            delete [] buffer;
+        }
+    }
+
+    void assign(JSContextRef ctx, JSValueRef value, JSValueRef *exception)
+    {
+        auto str = JSValueToStringCopy(ctx, value, exception);
+        if (str == nullptr)
+        {
+            length = 0;
+            buffer[0] = '\0';
+            return;
+        }
+        assign(str);
+        JSStringRelease(str);
+    }
+
+    void assign(JSStringRef str)
+    {
+        auto capacity = buffer == storage ? InlineSize : heapSize;
+        length = HyperloopJSStringGetUTF8(str, buffer, capacity);
+        if (length >= capacity)
+        {
+            if (buffer != storage)
+            {
+                delete [] buffer;
+            }
+            heapSize = length + 1;
+            buffer = new char[heapSize];
+            HyperloopJSStringGetUTF8(str, buffer, heapSize);
+        }
+    }
+
+    char* data() { return buffer; }
+    const char* c_str() const { return buffer; }
+    size_t size() const { return length; }
+    char operator[](size_t index) const { return buffer[index]; }
+    std::string str() const { return std::string(buffer, length); }
+
+private:
+    StringBuffer(const StringBuffer&);
+    StringBuffer& operator=(const StringBuffer&);
+
+    char *buffer;
+    size_t length;
+    size_t heapSize = 0;
+    char storage[InlineSize];
+};
+
 class AbstractObject
 {
 public:
+#if HL_NATIVE_OBJECT_POOL
+    static void* operator new(size_t size)
+    {
+        return PoolAllocate(size);
+    }
+
+    static void operator delete(void *pointer, size_t size)
+    {
+        PoolDeallocate(pointer, size);
+    }
+#endif
+
     AbstractObject(void* data)
         : data{data} 
     {
     }
 
-    ~AbstractObject() 
+    /**
+     * virtual so deleting through an AbstractObject pointer hands the sized
+     * operator delete the size of the derived object
+     */
+    virtual ~AbstractObject() 
     {
     }
     
@@ -0,0 +1,307 @@
+/**
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License
+ * Please see the LICENSE included with this distribution for details.
+ *
+ * This code and related technologies are covered by patents
+ * or patents pending by Appcelerator, Inc.
+ */
+#include <hyperloop.h>
+#include <thread>
+#include <condition_variable>
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+#ifndef HL_LOG_BUFFER_SIZE
+#define HL_LOG_BUFFER_SIZE 65536
+#endif
+
+#ifndef HL_LOG_OVERFLOW_POLICY
+#define HL_LOG_OVERFLOW_POLICY HyperloopLogOverflowBlock
+#endif
+
+#if HL_ASYNC_LOG
+
+namespace Hyperloop
+{
+    /**
+     * log records are appended to a preallocated ring by the threads calling
+     * HyperloopLog and handed to HyperloopNativeLogger by a background thread.
+     *
+     * a record is a 4 byte length followed by the NUL terminated message, padded
+     * to 4 bytes. a record never wraps: when it doesn't fit before the end of the
+     * ring a skip marker sends the reader back to the start. head and tail only
+     * grow, the reader only moves tail and writers only move head
+     */
+    class AsyncLogger
+    {
+    public:
+        AsyncLogger()
+            : head(0), tail(0), dropped(0), waiting(false), running(false), stopping(false),
+              policy(HL_LOG_OVERFLOW_POLICY)
+        {
+            buffer = new char[Capacity];
+        }
+
+        ~AsyncLogger()
+        {
+            stop();
+            delete [] buffer;
+        }
+
+        void log(const char *message, size_t length)
+        {
+            auto need = RecordSize(length);
+            std::unique_lock<std::mutex> lock(writer);
+            if (need > Capacity / 2 || !start())
+            {
+                // too big for the ring (or logging is shutting down), keep
+                // ordering by draining what's queued first
+                flush();
+                HyperloopNativeLogger(message);
+                return;
+            }
+            auto h = head.load(std::memory_order_relaxed);
+            size_t skip = 0;
+            for (;;)
+            {
+                auto contiguous = Capacity - (h & Mask);
+                skip = contiguous < need ? contiguous : 0;
+                if (Capacity - (h - tail.load(std::memory_order_acquire)) >= need + skip)
+                {
+                    break;
+                }
+                if (policy.load(std::memory_order_relaxed) == HyperloopLogOverflowDrop)
+                {
+                    dropped.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+                wake();
+                std::unique_lock<std::mutex> wait(signal);
+                drained.wait_for(wait, std::chrono::milliseconds(1));
+            }
+            if (skip)
+            {
+                WriteLength(h, SkipMarker);
+                h += skip;
+            }
+            WriteLength(h, static_cast<uint32_t>(length));
+            memcpy(buffer + (h & Mask) + sizeof(uint32_t), message, length);
+            buffer[(h & Mask) + sizeof(uint32_t) + length] = '\0';
+            head.store(h + need, std::memory_order_seq_cst);
+            lock.unlock();
+
+            if (waiting.load(std::memory_order_seq_cst))
+            {
+                wake();
+            }
+        }
+
+        /**
+         * block until every record appended so far has been logged
+         */
+        void flush()
+        {
+            if (!running.load(std::memory_order_acquire))
+            {
+                return;
+            }
+            auto target = head.load(std::memory_order_acquire);
+            while (tail.load(std::memory_order_acquire) < target)
+            {
+                wake();
+                std::unique_lock<std::mutex> wait(signal);
+                drained.wait_for(wait, std::chrono::milliseconds(1));
+            }
+        }
+
+        void setPolicy(HyperloopLogOverflowPolicy p)
+        {
+            policy.store(p, std::memory_order_relaxed);
+        }
+
+        size_t droppedCount() const
+        {
+            return dropped.load(std::memory_order_relaxed);
+        }
+
+    private:
+        static const size_t Capacity = HL_LOG_BUFFER_SIZE;
+        static const size_t Mask = Capacity - 1;
+        static const uint32_t SkipMarker = 0xffffffff;
+
+        static size_t RecordSize(size_t length)
+        {
+            return (sizeof(uint32_t) + length + 1 + 3) & ~static_cast<size_t>(3);
+        }
+
+        void WriteLength(size_t position, uint32_t length)
+        {
+            memcpy(buffer + (position & Mask), &length, sizeof(length));
+        }
+
+        uint32_t ReadLength(size_t position) const
+        {
+            uint32_t length;
+            memcpy(&length, buffer + (position & Mask), sizeof(length));
+            return length;
+        }
+
+        void wake()
+        {
+            std::lock_guard<std::mutex> lock(signal);
+            pending.notify_one();
+        }
+
+        bool start()
+        {
+            if (running.load(std::memory_order_acquire))
+            {
+                return true;
+            }
+            std::lock_guard<std::mutex> lock(lifecycle);
+            if (!running.load(std::memory_order_relaxed) && !stopping)
+            {
+                thread = std::thread(&AsyncLogger::drain, this);
+                running.store(true, std::memory_order_release);
+            }
+            return running.load(std::memory_order_relaxed);
+        }
+
+        void stop()
+        {
+            std::lock_guard<std::mutex> lock(lifecycle);
+            if (!running.load(std::memory_order_relaxed))
+            {
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> guard(signal);
+                stopping = true;
+                pending.notify_one();
+            }
+            thread.join();
+            running.store(false, std::memory_order_release);
+        }
+
+        void reportDropped(size_t &reported)
+        {
+            auto count = dropped.load(std::memory_order_relaxed);
+            if (count != reported)
+            {
+                char message[64];
+                snprintf(message, sizeof(message), "[%lu log messages dropped]", static_cast<unsigned long>(count - reported));
+                HyperloopNativeLogger(message);
+                reported = count;
+            }
+        }
+
+        void drain()
+        {
+            size_t reported = 0;
+            for (;;)
+            {
+                auto t = tail.load(std::memory_order_relaxed);
+                auto h = head.load(std::memory_order_acquire);
+                if (t == h)
+                {
+                    reportDropped(reported);
+                    std::unique_lock<std::mutex> wait(signal);
+                    drained.notify_all();
+                    if (stopping && head.load(std::memory_order_acquire) == t)
+                    {
+                        return;
+                    }
+                    waiting.store(true, std::memory_order_seq_cst);
+                    if (head.load(std::memory_order_seq_cst) == t)
+                    {
+                        pending.wait_for(wait, std::chrono::milliseconds(50));
+                    }
+                    waiting.store(false, std::memory_order_relaxed);
+                    continue;
+                }
+                // hand the whole batch over before giving the space back
+                while (t != h)
+                {
+                    auto length = ReadLength(t);
+                    if (length == SkipMarker)
+                    {
+                        t += Capacity - (t & Mask);
+                        continue;
+                    }
+                    HyperloopNativeLogger(buffer + (t & Mask) + sizeof(uint32_t));
+                    t += RecordSize(length);
+                }
+                tail.store(t, std::memory_order_release);
+                std::lock_guard<std::mutex> lock(signal);
+                drained.notify_all();
+            }
+        }
+
+        char *buffer;
+        std::atomic<size_t> head;
+        std::atomic<size_t> tail;
+        std::atomic<size_t> dropped;
+        std::atomic<bool> waiting;
+        std::atomic<bool> running;
+        bool stopping;
+        std::atomic<int> policy;
+        std::mutex writer;
+        std::mutex signal;
+        std::mutex lifecycle;
+        std::condition_variable pending;
+        std::condition_variable drained;
+        std::thread thread;
+    };
+
+    static AsyncLogger& GetAsyncLogger()
+    {
+        static AsyncLogger logger;
+        return logger;
+    }
+}
+
+static_assert((HL_LOG_BUFFER_SIZE & (HL_LOG_BUFFER_SIZE - 1)) == 0, "HL_LOG_BUFFER_SIZE must be a power of two");
+
+EXPORTAPI void HyperloopLog(const char *message, size_t length)
+{
+    Hyperloop::GetAsyncLogger().log(message, length);
+}
+
+EXPORTAPI void HyperloopLogFlush()
+{
+    Hyperloop::GetAsyncLogger().flush();
+}
+
+EXPORTAPI void HyperloopSetLogOverflowPolicy(HyperloopLogOverflowPolicy policy)
+{
+    Hyperloop::GetAsyncLogger().setPolicy(policy);
+}
+
+EXPORTAPI size_t HyperloopLogDroppedCount()
+{
+    return Hyperloop::GetAsyncLogger().droppedCount();
+}
+
+#else
+
+EXPORTAPI void HyperloopLog(const char *message, size_t length)
+{
+    HyperloopNativeLogger(message);
+}
+
+EXPORTAPI void HyperloopLogFlush()
+{
+}
+
+EXPORTAPI void HyperloopSetLogOverflowPolicy(HyperloopLogOverflowPolicy policy)
+{
+}
+
+EXPORTAPI size_t HyperloopLogDroppedCount()
+{
+    return 0;
+}
+
+#endif
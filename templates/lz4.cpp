@@ -0,0 +1,145 @@
+/**
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License
+ * Please see the LICENSE included with this distribution for details.
+ *
+ * This code and related technologies are covered by patents
+ * or patents pending by Appcelerator, Inc.
+ */
+#ifndef HL_TEST
+#include <hyperloop.h>
+#else
+#include <lz4.h>
+#include <base64.h>
+#endif
+#include <string.h>
+
+/**
+ * expand an LZ4 block into out, one output unit per byte. T is unsigned char
+ * for bytes or unsigned short to widen ASCII straight into UTF-16. matches
+ * copy units already written so they never need the key
+ */
+template <typename T>
+static size_t lz4_expand(const unsigned char *in, size_t length, unsigned char key, T *out, size_t size)
+{
+    const unsigned char *end = in + length;
+    size_t written = 0;
+    unsigned int b;
+
+    while (in < end) {
+        unsigned int token = *in++ ^ key;
+        size_t literals = token >> 4;
+        if (literals == 15) {
+            do {
+                if (in == end) {
+                    return written;
+                }
+                b = *in++ ^ key;
+                literals += b;
+            } while (b == 255);
+        }
+        if (literals > static_cast<size_t>(end - in) || literals > size - written) {
+            return written;
+        }
+        for (size_t i = 0; i < literals; i++) {
+            out[written + i] = static_cast<T>(in[i] ^ key);
+        }
+        in += literals;
+        written += literals;
+
+        // the last sequence is literals only
+        if (end - in < 2) {
+            break;
+        }
+        size_t offset = (in[0] ^ key) | ((in[1] ^ key) << 8);
+        in += 2;
+        size_t match = (token & 15) + 4;
+        if ((token & 15) == 15) {
+            do {
+                if (in == end) {
+                    return written;
+                }
+                b = *in++ ^ key;
+                match += b;
+            } while (b == 255);
+        }
+        if (offset == 0 || offset > written || match > size - written) {
+            return written;
+        }
+        T *dst = out + written;
+        const T *src = dst - offset;
+        if (offset >= match) {
+            memcpy(dst, src, match * sizeof(T));
+        } else {
+            // overlapping runs repeat the last offset units
+            for (size_t i = 0; i < match; i++) {
+                dst[i] = src[i];
+            }
+        }
+        written += match;
+    }
+    return written;
+}
+
+/**
+ * parse the header of a compressed source, returning where its block starts
+ * or nullptr when it is not one
+ */
+static const unsigned char *lz4_embed_header(const char *encoded, size_t length, unsigned char key, unsigned int *flags, size_t *size)
+{
+    const unsigned char *in = reinterpret_cast<const unsigned char *>(encoded);
+    const unsigned char *end = in + length;
+    if (length < 3 || (in[0] ^ key) != LZ4_EMBED_MARKER) {
+        return nullptr;
+    }
+    *flags = in[1] ^ key;
+    *size = 0;
+    in += 2;
+    for (unsigned int shift = 0; in < end && shift < 35; shift += 7) {
+        unsigned int b = *in++ ^ key;
+        *size |= static_cast<size_t>(b & 0x7F) << shift;
+        if ((b & 0x80) == 0) {
+            return in;
+        }
+    }
+    return nullptr;
+}
+
+bool lz4_embed_compressed(const char *encoded, size_t length, unsigned char key)
+{
+    return length > 0 && (static_cast<unsigned char>(encoded[0]) ^ key) == LZ4_EMBED_MARKER;
+}
+
+size_t lz4_embed_decoded_length(const char *encoded, size_t length, unsigned char key)
+{
+    unsigned int flags;
+    size_t size;
+    // a UTF-8 source never has more UTF-16 code units than bytes
+    return lz4_embed_header(encoded, length, key, &flags, &size) ? size : 0;
+}
+
+size_t lz4_embed_decode_utf16(const char *encoded, size_t length, unsigned char key, unsigned short *decoded)
+{
+    unsigned int flags;
+    size_t size;
+    auto block = lz4_embed_header(encoded, length, key, &flags, &size);
+    if (block == nullptr) {
+        return 0;
+    }
+    auto blockLength = length - static_cast<size_t>(block - reinterpret_cast<const unsigned char *>(encoded));
+    if (flags & LZ4_EMBED_ASCII) {
+        return lz4_expand(block, blockLength, key, decoded, size);
+    }
+    auto bytes = new unsigned char[size];
+    auto written = lz4_expand(block, blockLength, key, bytes, size);
+    auto count = utf8_decode_utf16(bytes, written, decoded);
+    // don't leave decoded source lying around on the heap
+    memset(bytes, 0, size);
+    delete [] bytes;
+    return count;
+}
+
+size_t lz4_decompress(const unsigned char *block, size_t length, unsigned char key, unsigned char *decoded, size_t size)
+{
+    return lz4_expand(block, length, key, decoded, size);
+}
@@ -0,0 +1,52 @@
+/**
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License
+ * Please see the LICENSE included with this distribution for details.
+ *
+ * This code and related technologies are covered by patents
+ * or patents pending by Appcelerator, Inc.
+ */
+#ifndef __HYPERLOOP_LZ4_HEADER__
+#define __HYPERLOOP_LZ4_HEADER__
+
+#include <stddef.h>
+
+/**
+ * an embedded source can be LZ4 block compressed instead of base64 encoded.
+ * the stream starts with a marker byte base64 never produces, a flags byte and
+ * the length of the UTF-8 source as a LEB128 varint, followed by the block.
+ * every byte is obfuscated by XOR'ing it with key like the base64 form
+ */
+#define LZ4_EMBED_MARKER 0xFF
+
+/**
+ * the source is ASCII, so the block expands straight into UTF-16 code units
+ */
+#define LZ4_EMBED_ASCII 0x01
+
+/**
+ * return true when the length bytes of encoded are a compressed source
+ */
+bool lz4_embed_compressed(const char *encoded, size_t length, unsigned char key);
+
+/**
+ * return the number of UTF-16 code units lz4_embed_decode_utf16 needs room for
+ */
+size_t lz4_embed_decoded_length(const char *encoded, size_t length, unsigned char key);
+
+/**
+ * decompress a compressed source into decoded, which must have room for
+ * lz4_embed_decoded_length(encoded, length, key) UTF-16 code units. malformed
+ * UTF-8 sequences are replaced with U+FFFD. returns the number of UTF-16 code
+ * units written
+ */
+size_t lz4_embed_decode_utf16(const char *encoded, size_t length, unsigned char key, unsigned short *decoded);
+
+/**
+ * decompress an LZ4 block of length bytes, each XOR'd with key, into decoded
+ * which has room for size bytes. decompression stops at malformed input.
+ * returns the number of bytes written
+ */
+size_t lz4_decompress(const unsigned char *block, size_t length, unsigned char key, unsigned char *decoded, size_t size);
+
+#endif
@@ -0,0 +1,250 @@
+/**
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License
+ * Please see the LICENSE included with this distribution for details.
+ *
+ * This code and related technologies are covered by patents
+ * or patents pending by Appcelerator, Inc.
+ */
+#include <hyperloop.h>
+#include <chrono>
+#include <deque>
+#include <vector>
+#include <stdio.h>
+
+#if HL_MODULE_STATS
+
+namespace Hyperloop
+{
+    /**
+     * the recorded module events. a deque so the strings handed out by
+     * HyperloopModuleStatsGet don't move as more are recorded
+     */
+    class ModuleStats
+    {
+    public:
+        struct Record
+        {
+            HyperloopModuleEventType type;
+            std::string path;
+            std::string parent;
+            std::string request;
+            std::string cache;
+            double start;
+            double duration;
+            unsigned thread;
+        };
+
+        ModuleStats() : epoch(std::chrono::steady_clock::now())
+        {
+        }
+
+        double now() const
+        {
+            return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch).count();
+        }
+
+        void record(HyperloopModuleEventType type, const char *path, const char *parent, const char *request, const char *cache, double start)
+        {
+            auto end = now();
+            std::lock_guard<std::mutex> lock(mutex);
+            records.push_back(Record{type, path ? path : "", parent ? parent : "", request ? request : "", cache ? cache : "", start, end - start, threadId()});
+        }
+
+        size_t count()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            return records.size();
+        }
+
+        bool get(size_t index, HyperloopModuleEvent *event)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (index >= records.size())
+            {
+                return false;
+            }
+            auto &r = records[index];
+            *event = HyperloopModuleEvent{r.type, r.path.c_str(), r.parent.c_str(), r.request.c_str(), r.cache.c_str(), r.start, r.duration, r.thread};
+            return true;
+        }
+
+        void reset()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            records.clear();
+        }
+
+        bool writeTrace(const char *filename)
+        {
+            auto file = fopen(filename, "w");
+            if (file == nullptr)
+            {
+                return false;
+            }
+            static const char *categories[] = { "resolve", "load", "decode", "evaluate", "prefetch" };
+            std::lock_guard<std::mutex> lock(mutex);
+            fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", file);
+            for (size_t c = 0; c < records.size(); c++)
+            {
+                auto &r = records[c];
+                fprintf(file, "%s\n{\"name\":", c ? "," : "");
+                writeString(file, r.path);
+                fprintf(file, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"parent\":", categories[r.type], r.start, r.duration, r.thread);
+                writeString(file, r.parent);
+                fputs(",\"request\":", file);
+                writeString(file, r.request);
+                fputs(",\"cache\":", file);
+                writeString(file, r.cache);
+                fputs("}}", file);
+            }
+            fputs("\n]}\n", file);
+            return fclose(file) == 0;
+        }
+
+    private:
+        static unsigned threadId()
+        {
+            static std::atomic<unsigned> threads(0);
+            thread_local unsigned id = ++threads;
+            return id;
+        }
+
+        static void writeString(FILE *file, const std::string &str)
+        {
+            fputc('"', file);
+            for (auto ch : str)
+            {
+                auto c = static_cast<unsigned char>(ch);
+                if (c == '"' || c == '\\')
+                {
+                    fputc('\\', file);
+                    fputc(c, file);
+                }
+                else if (c < 0x20)
+                {
+                    fprintf(file, "\\u%04x", c);
+                }
+                else
+                {
+                    fputc(c, file);
+                }
+            }
+            fputc('"', file);
+        }
+
+        std::chrono::steady_clock::time_point epoch;
+        std::mutex mutex;
+        std::deque<Record> records;
+    };
+
+    static ModuleStats& GetModuleStats()
+    {
+        static ModuleStats stats;
+        return stats;
+    }
+
+    /**
+     * the modules being loaded on this thread, innermost last
+     */
+    static std::vector<const char *>& GetModuleStack()
+    {
+        thread_local std::vector<const char *> stack;
+        return stack;
+    }
+}
+
+EXPORTAPI void HyperloopModuleStatsRecord(HyperloopModuleEventType type, const char *path, const char *parent, const char *request, const char *cache, double start)
+{
+    Hyperloop::GetModuleStats().record(type, path, parent, request, cache, start);
+}
+
+EXPORTAPI double HyperloopModuleStatsNow()
+{
+    return Hyperloop::GetModuleStats().now();
+}
+
+EXPORTAPI const char* HyperloopModuleStatsCurrent()
+{
+    auto &stack = Hyperloop::GetModuleStack();
+    return stack.empty() ? nullptr : stack.back();
+}
+
+EXPORTAPI void HyperloopModuleStatsPush(const char *path)
+{
+    Hyperloop::GetModuleStack().push_back(path);
+}
+
+EXPORTAPI void HyperloopModuleStatsPop()
+{
+    auto &stack = Hyperloop::GetModuleStack();
+    if (!stack.empty())
+    {
+        stack.pop_back();
+    }
+}
+
+EXPORTAPI size_t HyperloopModuleStatsCount()
+{
+    return Hyperloop::GetModuleStats().count();
+}
+
+EXPORTAPI bool HyperloopModuleStatsGet(size_t index, HyperloopModuleEvent *event)
+{
+    return Hyperloop::GetModuleStats().get(index, event);
+}
+
+EXPORTAPI void HyperloopModuleStatsReset()
+{
+    Hyperloop::GetModuleStats().reset();
+}
+
+EXPORTAPI bool HyperloopModuleStatsWriteTrace(const char *filename)
+{
+    return Hyperloop::GetModuleStats().writeTrace(filename);
+}
+
+#else
+
+EXPORTAPI void HyperloopModuleStatsRecord(HyperloopModuleEventType type, const char *path, const char *parent, const char *request, const char *cache, double start)
+{
+}
+
+EXPORTAPI double HyperloopModuleStatsNow()
+{
+    return 0;
+}
+
+EXPORTAPI const char* HyperloopModuleStatsCurrent()
+{
+    return nullptr;
+}
+
+EXPORTAPI void HyperloopModuleStatsPush(const char *path)
+{
+}
+
+EXPORTAPI void HyperloopModuleStatsPop()
+{
+}
+
+EXPORTAPI size_t HyperloopModuleStatsCount()
+{
+    return 0;
+}
+
+EXPORTAPI bool HyperloopModuleStatsGet(size_t index, HyperloopModuleEvent *event)
+{
+    return false;
+}
+
+EXPORTAPI void HyperloopModuleStatsReset()
+{
+}
+
+EXPORTAPI bool HyperloopModuleStatsWriteTrace(const char *filename)
+{
+    return false;
+}
+
+#endif
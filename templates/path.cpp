@@ -0,0 +1,135 @@
+/**
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License
+ * Please see the LICENSE included with this distribution for details.
+ *
+ * This code and related technologies are covered by patents
+ * or patents pending by Appcelerator, Inc.
+ */
+#ifndef HL_TEST
+#include <hyperloop.h>
+#else
+#include <path.h>
+#endif
+#include <string.h>
+#include <stdlib.h>
+
+Hyperloop::PathView::PathView(const char *str) : data(str), length(strlen(str))
+{
+}
+
+Hyperloop::PathBuffer::~PathBuffer()
+{
+    if (buffer != storage)
+    {
+        free(buffer);
+    }
+}
+
+void Hyperloop::PathBuffer::append(const char *str, size_t len)
+{
+    if (length + len + 1 > capacity)
+    {
+        auto size = capacity * 2;
+        while (size < length + len + 1)
+        {
+            size *= 2;
+        }
+        auto grown = static_cast<char *>(malloc(size));
+        memcpy(grown, buffer, length);
+        if (buffer != storage)
+        {
+            free(buffer);
+        }
+        buffer = grown;
+        capacity = size;
+    }
+    memcpy(buffer + length, str, len);
+    length += len;
+    buffer[length] = '\0';
+}
+
+/**
+ * append the segments of path to the absolute path in out, dropping empty and
+ * '.' segments and letting '..' remove the last one. each character of out is
+ * appended and removed at most once so this is linear
+ */
+static void AppendSegments(Hyperloop::PathView path, Hyperloop::PathBuffer &out)
+{
+    auto p = path.data;
+    auto end = path.data + path.length;
+    while (p < end)
+    {
+        auto slash = static_cast<const char *>(memchr(p, '/', end - p));
+        auto segmentEnd = slash ? slash : end;
+        auto len = static_cast<size_t>(segmentEnd - p);
+        if (len == 0 || (len == 1 && p[0] == '.'))
+        {
+            // skip
+        }
+        else if (len == 2 && p[0] == '.' && p[1] == '.')
+        {
+            auto size = out.size();
+            while (size > 1 && out.data()[size - 1] != '/')
+            {
+                size--;
+            }
+            // drop the separator too, unless it is the root
+            out.truncate(size > 1 ? size - 1 : 1);
+        }
+        else
+        {
+            if (out.back() != '/')
+            {
+                out.push_back('/');
+            }
+            out.append(p, len);
+        }
+        p = segmentEnd + 1;
+    }
+}
+
+void Hyperloop::PathResolve(PathView dir, PathView path, PathBuffer &out)
+{
+    out.clear();
+    out.push_back('/');
+    if (path.length == 0 || path.data[0] != '/')
+    {
+        AppendSegments(dir, out);
+    }
+    AppendSegments(path, out);
+}
+
+Hyperloop::NodeModulesPaths::NodeModulesPaths(PathView dir) : position(1)
+{
+    PathResolve(PathView(), dir, dirname);
+}
+
+/**
+ * the ancestors of dirname are visited from the root down, which is the order
+ * require has always searched them in. the root itself is only searched when
+ * dirname is the root
+ */
+bool Hyperloop::NodeModulesPaths::next(PathBuffer &out)
+{
+    static const char suffix[] = "/node_modules";
+    if (position > dirname.size())
+    {
+        return false;
+    }
+    if (dirname.size() == 1)
+    {
+        position = 2;
+        out.clear();
+        out.append(suffix, sizeof(suffix) - 1);
+        return true;
+    }
+    auto start = dirname.data() + position;
+    auto slash = static_cast<const char *>(memchr(start, '/', dirname.size() - position));
+    auto end = slash ? static_cast<size_t>(slash - dirname.data()) : dirname.size();
+    out.clear();
+    out.append(dirname.data(), end);
+    out.append(suffix, sizeof(suffix) - 1);
+    position = end + 1;
+    return true;
+}
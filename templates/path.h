@@ -0,0 +1,93 @@
+/**
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License
+ * Please see the LICENSE included with this distribution for details.
+ *
+ * This code and related technologies are covered by patents
+ * or patents pending by Appcelerator, Inc.
+ */
+#ifndef __HYPERLOOP_PATH_HEADER__
+#define __HYPERLOOP_PATH_HEADER__
+
+#include <string>
+#include <stddef.h>
+
+namespace Hyperloop
+{
+    /**
+     * a path or path segment borrowed from someone else's storage
+     */
+    struct PathView
+    {
+        const char *data;
+        size_t length;
+
+        PathView() : data(""), length(0) {}
+        PathView(const char *str);
+        PathView(const char *str, size_t len) : data(str), length(len) {}
+        PathView(const std::string &str) : data(str.data()), length(str.size()) {}
+
+        std::string str() const { return std::string(data, length); }
+    };
+
+    /**
+     * a path built in place. it stays in inline storage unless it outgrows it
+     */
+    class PathBuffer
+    {
+    public:
+        PathBuffer() : buffer(storage), length(0), capacity(sizeof(storage)) { storage[0] = '\0'; }
+        ~PathBuffer();
+
+        const char* data() const { return buffer; }
+        const char* c_str() const { return buffer; }
+        size_t size() const { return length; }
+        bool empty() const { return length == 0; }
+        char back() const { return length ? buffer[length - 1] : '\0'; }
+        PathView view() const { return PathView(buffer, length); }
+        std::string str() const { return std::string(buffer, length); }
+
+        void clear() { truncate(0); }
+        void truncate(size_t size) { length = size; buffer[length] = '\0'; }
+        void append(const char *str, size_t len);
+        void append(PathView view) { append(view.data, view.length); }
+        void push_back(char ch) { append(&ch, 1); }
+
+    private:
+        PathBuffer(const PathBuffer&);
+        PathBuffer& operator=(const PathBuffer&);
+
+        char storage[256];
+        char *buffer;
+        size_t length;
+        size_t capacity;
+    };
+
+    /**
+     * write the absolute, normalized form of path to out the way
+     * path.resolve(dir, path) does, in one pass over dir and path. dir is
+     * ignored when path is absolute and treated as absolute when it is not
+     */
+    void PathResolve(PathView dir, PathView path, PathBuffer &out);
+
+    /**
+     * the node_modules directories searched for a module required from a module
+     * in dirname, generated one at a time
+     */
+    class NodeModulesPaths
+    {
+    public:
+        explicit NodeModulesPaths(PathView dirname);
+
+        /**
+         * write the next directory to out, false when there are no more
+         */
+        bool next(PathBuffer &out);
+
+    private:
+        PathBuffer dirname;
+        size_t position;
+    };
+}
+
+#endif
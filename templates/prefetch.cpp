@@ -0,0 +1,336 @@
+/**
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License
+ * Please see the LICENSE included with this distribution for details.
+ *
+ * This code and related technologies are covered by patents
+ * or patents pending by Appcelerator, Inc.
+ */
+#include <hyperloop.h>
+#include <thread>
+#include <condition_variable>
+#include <unordered_map>
+#include <vector>
+#include <deque>
+
+#ifndef HL_PREFETCH_THREADS
+#define HL_PREFETCH_THREADS 4
+#endif
+
+#if HL_PREFETCH
+
+namespace Hyperloop
+{
+    /**
+     * decodes embedded sources on background threads in the order a require
+     * graph walk from the root reaches them. decoding only creates JSStrings so
+     * it never needs the VM. the JS thread takes a source when its module loads:
+     * ready strings are handed over, one being decoded is waited for and one not
+     * started yet is decoded right there and never by a worker
+     */
+    class Prefetcher
+    {
+    public:
+        Prefetcher() : next(0), stopping(false), prefetched(0), decoded(0)
+        {
+        }
+
+        ~Prefetcher()
+        {
+            stop();
+        }
+
+        void add(const HyperloopPrefetchEntry *entries, size_t count, unsigned char key)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto base = slots.size();
+            for (size_t c = 0; c < count; c++)
+            {
+                slots.emplace_back(&entries[c], key, base);
+                auto &slot = slots.back();
+                paths.emplace(entries[c].path, &slot);
+                if (entries[c].encoded)
+                {
+                    sources.emplace(entries[c].encoded, &slot);
+                }
+            }
+        }
+
+        void start(const char *path)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto found = paths.find(path);
+            if (found == paths.end())
+            {
+                return;
+            }
+            // breadth first, so the workers run ahead of the requires in about
+            // the order they happen
+            auto first = queue.size();
+            enqueue(found->second);
+            for (auto i = first; i < queue.size(); i++)
+            {
+                auto slot = queue[i];
+                for (size_t d = 0; d < slot->entry->dependencyCount; d++)
+                {
+                    enqueue(&slots[slot->base + slot->entry->dependencies[d]]);
+                }
+            }
+            if (workers.empty())
+            {
+                auto count = std::thread::hardware_concurrency();
+                count = count > 1 ? count - 1 : 1;
+                count = count < HL_PREFETCH_THREADS ? count : HL_PREFETCH_THREADS;
+                for (unsigned c = 0; c < count; c++)
+                {
+                    workers.push_back(std::thread(&Prefetcher::work, this));
+                }
+            }
+            pending.notify_all();
+        }
+
+        void stop()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+                pending.notify_all();
+            }
+            for (auto &worker : workers)
+            {
+                worker.join();
+            }
+            workers.clear();
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto &slot : slots)
+            {
+                if (slot.string)
+                {
+                    JSStringRelease(slot.string);
+                    slot.string = nullptr;
+                }
+                slot.state = Pending;
+                slot.queued = false;
+            }
+            queue.clear();
+            next = 0;
+            stopping = false;
+        }
+
+        JSStringRef take(const char *encoded, size_t length, unsigned char key)
+        {
+#if HL_MODULE_STATS
+            auto start = HyperloopModuleStatsNow();
+            const char *outcome = "prefetched";
+#endif
+            std::unique_lock<std::mutex> lock(mutex);
+            auto found = sources.find(encoded);
+            if (found != sources.end())
+            {
+                auto slot = found->second;
+                while (slot->state == Decoding)
+                {
+#if HL_MODULE_STATS
+                    outcome = "waited";
+#endif
+                    ready.wait(lock);
+                }
+                if (slot->state == Ready)
+                {
+                    auto string = slot->string;
+                    slot->string = nullptr;
+                    slot->state = Taken;
+                    prefetched++;
+#if HL_MODULE_STATS
+                    lock.unlock();
+                    HyperloopModuleStatsRecord(HyperloopModuleEventDecode, HyperloopModuleStatsCurrent(), nullptr, nullptr, outcome, start);
+#endif
+                    return string;
+                }
+                slot->state = Taken;
+            }
+            decoded++;
+            lock.unlock();
+#if HL_MODULE_STATS
+            auto string = HyperloopDecodeEmbedString(encoded, length, key);
+            HyperloopModuleStatsRecord(HyperloopModuleEventDecode, HyperloopModuleStatsCurrent(), nullptr, nullptr, "decoded", start);
+            return string;
+#else
+            return HyperloopDecodeEmbedString(encoded, length, key);
+#endif
+        }
+
+        void stats(size_t *prefetchedCount, size_t *decodedCount, size_t *readyCount)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (prefetchedCount)
+            {
+                *prefetchedCount = prefetched;
+            }
+            if (decodedCount)
+            {
+                *decodedCount = decoded;
+            }
+            if (readyCount)
+            {
+                size_t count = 0;
+                for (auto &slot : slots)
+                {
+                    count += slot.state == Ready ? 1 : 0;
+                }
+                *readyCount = count;
+            }
+        }
+
+    private:
+        enum State { Pending, Decoding, Ready, Taken };
+
+        struct Slot
+        {
+            Slot(const HyperloopPrefetchEntry *entry, unsigned char key, size_t base)
+                : entry(entry), key(key), base(base), state(Pending), string(nullptr), queued(false)
+            {
+            }
+
+            const HyperloopPrefetchEntry *entry;
+            unsigned char key;
+            size_t base;
+            State state;
+            JSStringRef string;
+            bool queued;
+        };
+
+        void enqueue(Slot *slot)
+        {
+            if (!slot->queued)
+            {
+                slot->queued = true;
+                queue.push_back(slot);
+            }
+        }
+
+        void work()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            for (;;)
+            {
+                while (!stopping && next == queue.size())
+                {
+                    pending.wait(lock);
+                }
+                if (stopping)
+                {
+                    return;
+                }
+                auto slot = queue[next++];
+                if (slot->state != Pending || slot->entry->encoded == nullptr)
+                {
+                    continue;
+                }
+                slot->state = Decoding;
+                lock.unlock();
+#if HL_MODULE_STATS
+                auto start = HyperloopModuleStatsNow();
+#endif
+                auto string = HyperloopDecodeEmbedString(slot->entry->encoded, slot->entry->length, slot->key);
+#if HL_MODULE_STATS
+                HyperloopModuleStatsRecord(HyperloopModuleEventPrefetch, slot->entry->path, nullptr, nullptr, nullptr, start);
+#endif
+                lock.lock();
+                slot->string = string;
+                slot->state = Ready;
+                ready.notify_all();
+            }
+        }
+
+        std::mutex mutex;
+        std::condition_variable pending;
+        std::condition_variable ready;
+        std::deque<Slot> slots;
+        std::unordered_map<std::string, Slot*> paths;
+        std::unordered_map<const char*, Slot*> sources;
+        std::vector<Slot*> queue;
+        size_t next;
+        std::vector<std::thread> workers;
+        bool stopping;
+        size_t prefetched;
+        size_t decoded;
+    };
+
+    static Prefetcher& GetPrefetcher()
+    {
+        static Prefetcher prefetcher;
+        return prefetcher;
+    }
+}
+
+EXPORTAPI bool HyperloopRegisterPrefetchGraph(const HyperloopPrefetchEntry *entries, size_t count, unsigned char key)
+{
+    Hyperloop::GetPrefetcher().add(entries, count, key);
+    return true;
+}
+
+EXPORTAPI void HyperloopPrefetchStart(const char *path)
+{
+    Hyperloop::GetPrefetcher().start(path);
+}
+
+EXPORTAPI void HyperloopPrefetchStop()
+{
+    Hyperloop::GetPrefetcher().stop();
+}
+
+EXPORTAPI JSStringRef HyperloopTakeEmbedString(const char *encoded, size_t length, unsigned char key)
+{
+    return Hyperloop::GetPrefetcher().take(encoded, length, key);
+}
+
+EXPORTAPI void HyperloopPrefetchStats(size_t *prefetched, size_t *decoded, size_t *ready)
+{
+    Hyperloop::GetPrefetcher().stats(prefetched, decoded, ready);
+}
+
+#else
+
+EXPORTAPI bool HyperloopRegisterPrefetchGraph(const HyperloopPrefetchEntry *entries, size_t count, unsigned char key)
+{
+    return true;
+}
+
+EXPORTAPI void HyperloopPrefetchStart(const char *path)
+{
+}
+
+EXPORTAPI void HyperloopPrefetchStop()
+{
+}
+
+EXPORTAPI JSStringRef HyperloopTakeEmbedString(const char *encoded, size_t length, unsigned char key)
+{
+#if HL_MODULE_STATS
+    auto start = HyperloopModuleStatsNow();
+    auto string = HyperloopDecodeEmbedString(encoded, length, key);
+    HyperloopModuleStatsRecord(HyperloopModuleEventDecode, HyperloopModuleStatsCurrent(), nullptr, nullptr, "decoded", start);
+    return string;
+#else
+    return HyperloopDecodeEmbedString(encoded, length, key);
+#endif
+}
+
+EXPORTAPI void HyperloopPrefetchStats(size_t *prefetched, size_t *decoded, size_t *ready)
+{
+    if (prefetched)
+    {
+        *prefetched = 0;
+    }
+    if (decoded)
+    {
+        *decoded = 0;
+    }
+    if (ready)
+    {
+        *ready = 0;
+    }
+}
+
+#endif
@@ -7,18 +7,20 @@
  * or patents pending by Appcelerator, Inc.
  */
 #include <hyperloop.h>
-#include <list>
 #include <vector>
-#include <set>
+#include <deque>
 #include <algorithm>
+#include <unordered_map>
 #include <stdarg.h>
+#include <string.h>
 
 #ifndef REQUIRE_DEBUG
 #define REQUIRE_DEBUG 0
 #endif
 
-static bool HyperloopLoadEmbedSourceExists (const char *filepath);
+static bool HyperloopLoadEmbedSourceExists (const char *filepath, size_t length);
 static JSValueRef HyperloopLoadEmbedSource(JSGlobalContextRef ctx, const JSObjectRef &object, const char *path, JSValueRef *exception);
+static JSClassRef RegisterBoundRequireClass();
 
 namespace Appcelerator
 {
@@ -31,9 +33,12 @@ namespace Appcelerator
         const std::string& getId() const { return filename; }
         const std::string& getDirname() const { return dirname; }
         const std::string& getFilename() const { return filename; }
+        JSValueRef getFilenameValue();
+        JSValueRef getDirnameValue();
+        JSObjectRef getRequire();
         JSObjectRef getObject() const { return object; }
         JSObjectRef getParent() const { return parent; }
-        JSObjectRef getChildren() const { return children; }
+        JSObjectRef getChildren();
         JSObjectRef getExports() const { return exports; }
         void setExports(JSObjectRef newExports) 
         { 
@@ -52,7 +57,11 @@ namespace Appcelerator
         JSObjectRef object;
         JSObjectRef parent;
         JSObjectRef exports;
+        std::vector<JSObjectRef> childModules;
         JSObjectRef children;
+        JSValueRef filenameValue;
+        JSValueRef dirnameValue;
+        JSObjectRef require;
         bool loaded;
     };
 }
@@ -66,19 +75,17 @@ static Appcelerator::Module * JSObjectRefToModule(const JSContextRef & ctx, cons
     auto module = static_cast<Appcelerator::Module*>(JSObjectGetPrivate(object));
     if (module==nullptr && ctx!=nullptr && force)
     {
-        auto p = JSStringCreateWithUTF8CString("module");
-        auto v = JSObjectGetProperty(ctx,object,p,exception);
+        auto v = JSObjectGetProperty(ctx,object,HyperloopWellKnownString(kHyperloopString_module),exception);
         if (v!=nullptr && JSValueIsObject(ctx,v))
         {
             auto o = JSValueToObject(ctx,v,exception);
             module = JSObjectRefToModule(ctx,o,exception);
         }
-        JSStringRelease(p);
     }
     return module;
 }
 
-Appcelerator::Module::Module(const JSGlobalContextRef & ctx, const JSObjectRef & object, const std::string & filename, const std::string & dirname, const JSObjectRef & parent, const JSObjectRef & exports) : object{object},filename{filename},dirname{dirname},ctx{ctx},parent{parent},loaded{false},exports{exports},children{nullptr}
+Appcelerator::Module::Module(const JSGlobalContextRef & ctx, const JSObjectRef & object, const std::string & filename, const std::string & dirname, const JSObjectRef & parent, const JSObjectRef & exports) : object{object},filename{filename},dirname{dirname},ctx{ctx},parent{parent},loaded{false},exports{exports},children{nullptr},filenameValue{nullptr},dirnameValue{nullptr},require{nullptr}
 {
     JSGlobalContextRetain(ctx);
     JSValueProtect(ctx,object);
@@ -99,6 +106,22 @@ Appcelerator::Module::~Module()
     {
         JSValueUnprotect(ctx,children);
     }
+    for (auto child : childModules)
+    {
+        JSValueUnprotect(ctx,child);
+    }
+    if (filenameValue!=nullptr)
+    {
+        JSValueUnprotect(ctx,filenameValue);
+    }
+    if (dirnameValue!=nullptr)
+    {
+        JSValueUnprotect(ctx,dirnameValue);
+    }
+    if (require!=nullptr)
+    {
+        JSValueUnprotect(ctx,require);
+    }
     JSValueUnprotect(ctx,exports);
     JSValueUnprotect(ctx,object);
     JSGlobalContextRelease(ctx);
@@ -109,253 +132,337 @@ Appcelerator::Module::~Module()
  */
 void Appcelerator::Module::addChild(const JSObjectRef & child)
 {
-    const JSValueRef elements[] = { child };
-    if (children==nullptr)
-    {
-        children = JSObjectMakeArray(ctx,1,elements,0);
-        JSValueProtect(ctx,children);
-    }
-    else 
+    JSValueProtect(ctx,child);
+    childModules.push_back(child);
+    // keep the JS array, if it was read already, in step
+    if (children!=nullptr)
     {
-        JSPropertyNameArrayRef childrenRef = JSObjectCopyPropertyNames(ctx,children);
-        JSObjectSetPropertyAtIndex(ctx, children, JSPropertyNameArrayGetCount(childrenRef), child, NULL);
-        JSPropertyNameArrayRelease(childrenRef);
+        JSObjectSetPropertyAtIndex(ctx,children,static_cast<unsigned>(childModules.size()-1),child,nullptr);
     }
 }
 
 /**
- * called when object is destroyed
+ * return the filename as a JS string, made once since it never changes
  */
-static void ModuleFinalizer(JSObjectRef object)
+JSValueRef Appcelerator::Module::getFilenameValue()
 {
-    auto module = JSObjectRefToModule(nullptr,object,nullptr);
-    if (module!=nullptr)
+    if (filenameValue==nullptr)
     {
-        delete module;
+        filenameValue = HyperloopMakeString(ctx,filename.c_str(),0);
+        JSValueProtect(ctx,filenameValue);
     }
+    return filenameValue;
 }
 
-std::vector<std::string> pathSplit(const std::string & path)
+/**
+ * return the dirname as a JS string, made once since it never changes
+ */
+JSValueRef Appcelerator::Module::getDirnameValue()
 {
-	std::vector<std::string> parts;
-	size_t pos = 0;
-	size_t len = path.length();
-    
-	while (pos <= len)
-	{
-		size_t idx = path.find("/",pos);
-		if (idx == std::string::npos)
-		{
-			parts.push_back(path.substr(pos));
-			break;
-		}
-		else
-		{
-            if (idx > 0)
-            {
-                parts.push_back(path.substr(pos,idx-pos));
-            }
-			pos = idx + 1;
-		}
-	}
-    
-    return parts;
+    if (dirnameValue==nullptr)
+    {
+        dirnameValue = HyperloopMakeString(ctx,dirname.c_str(),0);
+        JSValueProtect(ctx,dirnameValue);
+    }
+    return dirnameValue;
 }
 
-std::string pathJoin(std::vector<std::string> newparts)
+/**
+ * return the require function of this module. it points back at the module so
+ * calling it never has to look the module up from this or the global scope,
+ * and inherits call, apply and bind from Function.prototype
+ */
+JSObjectRef Appcelerator::Module::getRequire()
 {
-    std::string newpath = "/";
-
-    for (std::vector<std::string>::iterator i = newparts.begin(); i!=newparts.end(); i++)
+    if (require==nullptr)
     {
-        newpath+=*i;
-        #if REQUIRE_DEBUG == 1
-        	NSLog(@"pathJoin=%s",newpath.c_str());
-        #endif
-        i++;
-        if (i!=newparts.end())
-        {
-            newpath+="/";
-        }
-        i--;
+        require = Hyperloop::MakeFunctionObject(ctx,RegisterBoundRequireClass(),static_cast<void *>(this),
+            HyperloopWellKnownString(kHyperloopString_Function),HyperloopWellKnownString(kHyperloopString_prototype));
+        JSValueProtect(ctx,require);
     }
-    return newpath;
+    return require;
 }
 
-static std::string pathResolve(const std::string & path, std::string dir = "/")
+/**
+ * return the children as a JS array, built on first read
+ */
+JSObjectRef Appcelerator::Module::getChildren()
 {
-    dir = dir.length()==1 || dir.rfind("/")==dir.length() ? dir : dir + "/";
-    bool resolvedAbsolute = path.find("/")==0;
-    
-	std::vector<std::string> parts = pathSplit(path);
-    
-	size_t up = 0;
-    bool allowAboveRoot = !resolvedAbsolute;
-	std::vector<std::string> newparts;
-	for (std::vector<std::string>::reverse_iterator rit=parts.rbegin(); rit!=parts.rend(); rit++)
-	{
-		std::string last = *rit;
-		if (last == ".")
-		{
-			// skip
-		}
-		else if (last == "..")
-		{
-			// skip
-			up++;
-		}
-		else if (up)
-		{
-			// skip
-			up--;
-		}
-		else
-		{
-            std::vector<std::string>::iterator it = newparts.begin();
-			newparts.insert(it, last);
-		}
-	}
-    
-    if (allowAboveRoot)
+    if (children==nullptr)
     {
-        for (; up--;)
-        {
-            std::vector<std::string>::iterator it = newparts.begin();
-            newparts.insert(it, "..");
-        }
+        auto elements = reinterpret_cast<const JSValueRef *>(childModules.data());
+        children = JSObjectMakeArray(ctx,childModules.size(),elements,0);
+        JSValueProtect(ctx,children);
     }
-    
-    std::string newpath = pathJoin(newparts);
-
-	return resolvedAbsolute ? newpath : dir + newpath;
+    return children;
 }
 
-std::vector<std::string> slice(const std::vector<std::string> & list, const size_t & begin, const size_t & end=std::string::npos)
+/**
+ * called when object is destroyed
+ */
+static void ModuleFinalizer(JSObjectRef object)
 {
-    std::vector<std::string> newlist;
-    for (size_t i=begin; i<end; i++)
+    auto module = JSObjectRefToModule(nullptr,object,nullptr);
+    if (module!=nullptr)
     {
-        newlist.push_back(list[i]);
+        delete module;
     }
-    return newlist;
 }
 
-std::vector<std::string> getRequirePaths(const std::string & dirname)
+namespace Appcelerator
 {
-    std::vector<std::string> paths;
-    
-    if (dirname == "/")
+    /**
+     * true when two static table entries are for the same key
+     */
+    inline bool SameKey(const HyperloopRequireEntry &a, const HyperloopRequireEntry &b)
     {
-        paths.push_back("/node_modules");
+        return strcmp(a.dirname, b.dirname) == 0 && strcmp(a.request, b.request) == 0;
     }
-    else
+
+    inline bool SameKey(const HyperloopPackageMainEntry &a, const HyperloopPackageMainEntry &b)
     {
-        auto parts = pathSplit(dirname);
-#if REQUIRE_DEBUG == 1
-    	NSLog(@"getRequirePaths::dirname=%s, size=%d",dirname.c_str(), (int)parts.size());
-    	NSLog(@"getRequirePaths::parts=%s",pathJoin(parts).c_str());
-#endif
-        for (size_t i = 0, len = parts.size(); i < len; i++)
-        {
-            auto p = slice(parts, 0, len-i);
-            auto path = pathJoin(p) + "/node_modules";
-#if REQUIRE_DEBUG == 1
-    		NSLog(@"getRequirePaths::p=%s, %d",pathJoin(p).c_str(), (int)len-i);
-    		NSLog(@"getRequirePaths::path=%s",path.c_str());
-#endif
-            std::vector<std::string>::iterator it = paths.begin();
-            paths.insert(it, path);
-        }
+        return a.length == b.length && memcmp(a.directory, b.directory, a.length) == 0;
     }
-    return paths;
+
+    inline bool SameKey(const HyperloopTranslationUnitEntry &a, const HyperloopTranslationUnitEntry &b)
+    {
+        return a.length == b.length && memcmp(a.path, b.path, a.length) == 0;
+    }
+
+    /**
+     * open addressing hash index of entries in the static tables emitted by the
+     * compiler, each with the value its table was added with. slots point into
+     * the tables, nothing is copied. the first table to register a key owns it
+     */
+    template <typename Entry>
+    class StaticEntryIndex
+    {
+        public:
+            void add(const Entry *entries, size_t count, size_t value = 0)
+            {
+                reserve(used + count);
+                for (size_t c = 0; c < count; c++)
+                {
+                    insert(Slot{&entries[c], value});
+                }
+            }
+            template <typename Matches>
+            const Entry* find(uint32_t hash, Matches matches, size_t *value = nullptr) const
+            {
+                if (slots.empty())
+                {
+                    return nullptr;
+                }
+                auto mask = slots.size() - 1;
+                for (auto i = hash & mask; slots[i].entry != nullptr; i = (i + 1) & mask)
+                {
+                    auto &slot = slots[i];
+                    if (slot.entry->hash == hash && matches(*slot.entry))
+                    {
+                        if (value)
+                        {
+                            *value = slot.value;
+                        }
+                        return slot.entry;
+                    }
+                }
+                return nullptr;
+            }
+
+        private:
+            struct Slot
+            {
+                const Entry *entry;
+                size_t value;
+            };
+
+            void reserve(size_t count)
+            {
+                // keep the table at most half full
+                size_t size = slots.empty() ? 64 : slots.size();
+                while (size < count * 2)
+                {
+                    size *= 2;
+                }
+                if (size == slots.size())
+                {
+                    return;
+                }
+                std::vector<Slot> old(size, Slot{nullptr, 0});
+                old.swap(slots);
+                used = 0;
+                for (auto &slot : old)
+                {
+                    if (slot.entry != nullptr)
+                    {
+                        insert(slot);
+                    }
+                }
+            }
+            void insert(const Slot &slot)
+            {
+                auto mask = slots.size() - 1;
+                auto i = slot.entry->hash & mask;
+                for (; slots[i].entry != nullptr; i = (i + 1) & mask)
+                {
+                    if (slots[i].entry->hash == slot.entry->hash && SameKey(*slots[i].entry, *slot.entry))
+                    {
+                        return;
+                    }
+                }
+                slots[i] = slot;
+                used++;
+            }
+
+            std::vector<Slot> slots;
+            size_t used = 0;
+    };
 }
 
-bool fileExists(const std::string & path)
+static Appcelerator::StaticEntryIndex<HyperloopRequireEntry> requireTable;
+static Appcelerator::StaticEntryIndex<HyperloopPackageMainEntry> packageMainTable;
+
+/**
+ * called by a translation unit to register the requires it resolved at build time
+ */
+EXPORTAPI bool HyperloopRegisterRequireTable(const HyperloopRequireEntry *entries, size_t count)
 {
-    return HyperloopLoadEmbedSourceExists(path.c_str());
+    requireTable.add(entries, count);
+    return true;
+}
+
+/**
+ * called by a translation unit to register the main of the packages it embeds
+ */
+EXPORTAPI bool HyperloopRegisterPackageMainTable(const HyperloopPackageMainEntry *entries, size_t count)
+{
+    packageMainTable.add(entries, count);
+    return true;
+}
+
+/**
+ * return the requires resolved at build time for a request from dirname
+ */
+static const HyperloopRequireEntry* findPrecomputedRequire(const std::string & dirname, const std::string & request)
+{
+    auto hash = HyperloopRequireHash(dirname.data(), dirname.size(), request.data(), request.size());
+    return requireTable.find(hash, [&](const HyperloopRequireEntry &entry) {
+        return dirname == entry.dirname && request == entry.request;
+    });
+}
+
+/**
+ * return the package embedded in directory
+ */
+static const HyperloopPackageMainEntry* findPackageMain(const char *directory, size_t length)
+{
+    auto hash = HyperloopPathHash(directory, length);
+    return packageMainTable.find(hash, [&](const HyperloopPackageMainEntry &entry) {
+        return entry.length == length && memcmp(entry.directory, directory, length) == 0;
+    });
 }
 
-std::string loadAsFile(const JSObjectRef & parent, const std::string & path)
+static bool fileExists(const Hyperloop::PathBuffer & path)
 {
-    std::list<std::string> checks;
-    checks.push_back(path);
-    checks.push_back(path+".js");
-    checks.push_back(path+".json");
-    
-    for (std::list<std::string>::iterator i = checks.begin(); i!=checks.end(); i++)
+    return HyperloopLoadEmbedSourceExists(path.data(),path.size());
+}
+
+std::string loadAsFile(const JSObjectRef & parent, Hyperloop::PathBuffer & path)
+{
+    if (fileExists(path))
     {
-        auto check = *i;
-        if (fileExists(check))
-        {
-        	return check;
-        }
+        return path.str();
+    }
+    auto size = path.size();
+    path.append(".js",3);
+    if (fileExists(path))
+    {
+        return path.str();
+    }
+    path.truncate(size);
+    path.append(".json",5);
+    if (fileExists(path))
+    {
+        return path.str();
     }
+    path.truncate(size);
     return std::string();
 }
 
-std::string loadAsDirectory(const JSObjectRef & parent, const std::string & path)
+std::string loadAsDirectory(const JSObjectRef & parent, Hyperloop::PathBuffer & path)
 {
-	auto packageJSONFile = path + "/package.json";
+    auto size = path.size();
+    auto package = findPackageMain(path.data(),size);
+    path.append("/package.json",13);
 #if REQUIRE_DEBUG == 1
-	NSLog(@"loadAsDirectory::path=%s, packageJSONFile=%s",path.c_str(),packageJSONFile.c_str());
+	NSLog(@"loadAsDirectory::packageJSONFile=%s",path.c_str());
 #endif
-	if (fileExists(packageJSONFile))
+	if (package!=nullptr)
+	{
+		// the compiler read main for us
+		if (package->main!=nullptr)
+		{
+			path.truncate(size);
+			return std::string(package->main,package->mainLength);
+		}
+	}
+	else if (fileExists(path))
 	{
 		JSGlobalContextRef ctx = HyperloopGlobalContext();
-    	JSValueRef result = HyperloopLoadEmbedSource(ctx,parent,packageJSONFile.c_str(),0);
+    	JSValueRef result = HyperloopLoadEmbedSource(ctx,parent,path.c_str(),0);
     	if (result!=nullptr && JSValueIsObject(ctx,result))
     	{
-    		JSStringRef prop = JSStringCreateWithUTF8CString("main");
     		JSObjectRef json = JSValueToObject(ctx,result,0);
     		if (json!=nullptr) 
     		{
-	    		JSValueRef mainValue = JSObjectGetProperty(ctx,json,prop,0);
+	    		JSValueRef mainValue = JSObjectGetProperty(ctx,json,HyperloopWellKnownString(kHyperloopString_main),0);
 	    		if (JSValueIsString(ctx,mainValue)) 
 	    		{
-	    			std::string fp(HyperloopJSValueToStringCopy(ctx,mainValue,0));
-		    		JSStringRelease(prop);
-	    			return pathResolve(path+"/"+fp);
+	    			Hyperloop::StringBuffer fp(ctx,mainValue,0);
+	    			Hyperloop::PathBuffer mainFile;
+	    			Hyperloop::PathResolve(Hyperloop::PathView(path.data(),size),Hyperloop::PathView(fp.data(),fp.size()),mainFile);
+	    			path.truncate(size);
+	    			return mainFile.str();
 	    		}
     		}
-    		JSStringRelease(prop);
     	}
 	}
 
-	auto indexFile = path + "/index.js";
+	path.truncate(size);
+	path.append("/index.js",9);
 #if REQUIRE_DEBUG == 1
-	NSLog(@"loadAsDirectory::path=%s, indexFile=%s",path.c_str(),indexFile.c_str());
+	NSLog(@"loadAsDirectory::indexFile=%s",path.c_str());
 #endif
-	if (fileExists(indexFile))
+	if (fileExists(path))
 	{
-		return indexFile;
+		return path.str();
 	}
+	path.truncate(size);
 
     return std::string();
 }
 
-std::string loadAsModule (const JSObjectRef & parent, std::string resolvedPath, std::string dirname)
+std::string loadAsModule (const JSObjectRef & parent, const std::string & request, const std::string & dirname)
 {
 #if REQUIRE_DEBUG == 1
-    NSLog(@"loadAsModule resolvedPath=%s,dirname=%s",resolvedPath.c_str(),dirname.c_str());
+    NSLog(@"loadAsModule request=%s,dirname=%s",request.c_str(),dirname.c_str());
 #endif
-    auto reqPaths = getRequirePaths(dirname);
+    Hyperloop::NodeModulesPaths paths(dirname);
+    Hyperloop::PathBuffer directory;
+    Hyperloop::PathBuffer candidate;
     std::string modulePath;
-    if (resolvedPath.find("/")!=0)
+    while (paths.next(directory))
     {
-    	resolvedPath = "/" + resolvedPath;
-    }
-    for (size_t i=0, len=reqPaths.size(); i<len; i++)
-    {
-        auto newResolvedPath = reqPaths[i] + resolvedPath;
+        Hyperloop::PathResolve(directory.view(),request,candidate);
 #if REQUIRE_DEBUG == 1
-        NSLog(@"loadAsModule::[%d] newResolvedPath=%s",(int)i,newResolvedPath.c_str());
+        NSLog(@"loadAsModule::candidate=%s",candidate.c_str());
 #endif
-        modulePath = loadAsFile(parent,newResolvedPath);
+        modulePath = loadAsFile(parent,candidate);
         if (!modulePath.empty())
         {
             break;
         }
-        modulePath = loadAsDirectory(parent,newResolvedPath);
+        modulePath = loadAsDirectory(parent,candidate);
         if (!modulePath.empty())
         {
             break;
@@ -364,51 +471,110 @@ std::string loadAsModule (const JSObjectRef & parent, std::string resolvedPath,
     return modulePath;
 }
 
-std::string requestResolve(const JSObjectRef & parent, std::string p, std::string dirname = "/")
+/**
+ * true for the requests resolved against the requiring module's directory
+ */
+static bool isRelativeRequest(const std::string & p)
+{
+    return p=="." || p==".." || p.compare(0,2,"./")==0 || p.compare(0,3,"../")==0;
+}
+
+std::string requestResolve(const JSObjectRef & parent, const std::string & p, const std::string & dirname = "/")
 {
-    auto isNodeModule = false;
-    std::string rawPath;
-    
-    if (p.find("/")==0)
+#if REQUIRE_DEBUG == 1
+    NSLog(@"requestResolve::p=%s,dirname=%s",p.c_str(),dirname.c_str());
+#endif
+
+    if (p.empty() || (p[0]!='/' && !isRelativeRequest(p)))
     {
-        rawPath = p;
+        return loadAsModule(parent,p,dirname);
     }
-    else if (p.find("../")==0 || p.find("./")==0)
+
+    // load as file or load as directory
+    Hyperloop::PathBuffer resolvedPath;
+    Hyperloop::PathResolve(dirname,p,resolvedPath);
+    auto modulePath = loadAsFile(parent,resolvedPath);
+    if (modulePath.empty())
     {
-        rawPath = dirname + (dirname=="/" ? "" : "/") + p;
+        modulePath = loadAsDirectory(parent,resolvedPath);
     }
-    else
+    return modulePath;
+}
+
+namespace Appcelerator
+{
+    /**
+     * memoized requestResolve results keyed by dirname and request. a request
+     * that could not be resolved is cached as an empty path so that the next
+     * require of it doesn't walk node_modules again. only used from the JS thread
+     */
+    struct ResolveCache
     {
-        isNodeModule = true;
-        rawPath = p;
+        std::unordered_map<std::string, std::string> paths;
+        size_t hits = 0;
+        size_t misses = 0;
+    };
+}
+
+static Appcelerator::ResolveCache& GetResolveCache()
+{
+    static Appcelerator::ResolveCache cache;
+    return cache;
+}
+
+/**
+ * requestResolve through the resolution cache. outcome is set to "hit" or "miss"
+ */
+static const std::string& requestResolveCached(const JSObjectRef & parent, const std::string & p, const std::string & dirname = "/", const char **outcome = nullptr)
+{
+    auto &cache = GetResolveCache();
+    std::string key;
+    key.reserve(dirname.size() + p.size() + 1);
+    key += dirname;
+    key += '\0';
+    key += p;
+    auto it = cache.paths.find(key);
+    if (it != cache.paths.end())
+    {
+        cache.hits++;
+        outcome && (*outcome = "hit");
+        return it->second;
     }
-    
-    auto resolvedPath = pathResolve(rawPath,dirname);
-    std::string modulePath;
+    cache.misses++;
+    outcome && (*outcome = "miss");
+    auto resolved = requestResolve(parent,p,dirname);
+    return cache.paths.emplace(std::move(key), std::move(resolved)).first->second;
+}
 
-#if REQUIRE_DEBUG == 1
-    NSLog(@"requestResolve::rawPath=%s,resolvedPath=%s,dirname=%s,isNodeModule=%d",rawPath.c_str(),resolvedPath.c_str(),dirname.c_str(),(int)isNodeModule);
-#endif
+/**
+ * forget every memoized resolution
+ */
+EXPORTAPI void HyperloopResolveCacheClear()
+{
+    auto &cache = GetResolveCache();
+    cache.paths.clear();
+    cache.hits = 0;
+    cache.misses = 0;
+}
 
-    if (isNodeModule)
+/**
+ * return the resolution cache hit and miss counts and its size
+ */
+EXPORTAPI void HyperloopResolveCacheStats(size_t *hits, size_t *misses, size_t *size)
+{
+    auto &cache = GetResolveCache();
+    if (hits)
     {
-    	modulePath = loadAsModule(parent,resolvedPath,dirname);
-    	if (modulePath.empty()) 
-    	{
-	    	modulePath = loadAsModule(parent,p,dirname);
-    	}
+        *hits = cache.hits;
     }
-    else
+    if (misses)
     {
-        // load as file or load as directory
-        modulePath = loadAsFile(parent,resolvedPath);
-        if (modulePath.empty())
-        {
-            modulePath = loadAsDirectory(parent,resolvedPath);
-        }
+        *misses = cache.misses;
+    }
+    if (size)
+    {
+        *size = cache.paths.size();
     }
-    
-    return modulePath;
 }
 
 #ifndef USE_TIJSCORE
@@ -420,11 +586,12 @@ EXPORTAPI void HyperloopInitialize_Source();
 EXPORTAPI JSValueRef HyperloopAppRequire(JSValueRef *exception)
 {
 #ifdef USE_TIJSCORE
-    auto resolvedPath = requestResolve(nullptr,"/app.js");
+    auto resolvedPath = requestResolveCached(nullptr,"/app.js");
     return HyperloopLoadEmbedSource(InitializeHyperloop(HyperloopGlobalContext()),nullptr,resolvedPath.c_str(),exception);
 #else
     HyperloopInitialize_Source();
-    auto resolvedPath = requestResolve(nullptr,"/app.js");
+    HyperloopPrefetchStart("/app.js");
+    auto resolvedPath = requestResolveCached(nullptr,"/app.js");
     return HyperloopLoadEmbedSource(InitializeHyperloop(),nullptr,resolvedPath.c_str(),exception);
 #endif
 }
@@ -436,7 +603,8 @@ EXPORTAPI JSValueRef HyperloopAppRequire(JSValueRef *exception)
 EXPORTAPI JSValueRef HyperloopModuleRequire(JSGlobalContextRef ctx, JSValueRef *exception, const char *modulePath)
 {
     auto path = std::string(modulePath);
-    auto resolvedPath = requestResolve(nullptr,path.c_str());
+    auto resolvedPath = requestResolveCached(nullptr,path);
+    HyperloopPrefetchStart(resolvedPath.c_str());
     return HyperloopLoadEmbedSource(ctx,nullptr,resolvedPath.c_str(),exception);
 }
 #endif
@@ -444,7 +612,7 @@ EXPORTAPI JSValueRef HyperloopModuleRequire(JSGlobalContextRef ctx, JSValueRef *
 /**
  * implement the require which is relative to this module
  */
-static JSValueRef ModuleRequire(JSContextRef ctx, JSObjectRef function, JSObjectRef object, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception)
+static JSValueRef RequireFromModule(JSContextRef ctx, Appcelerator::Module *module, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception)
 {
     if (argumentCount == 0)
     {
@@ -454,7 +622,6 @@ static JSValueRef ModuleRequire(JSContextRef ctx, JSObjectRef function, JSObject
         *exception = HyperloopMakeException(ctx,"invalid module path passed to require");
         return JSValueMakeUndefined(ctx);
     }
-    auto module = JSObjectRefToModule(ctx,object,exception);
     if (module==nullptr)
     {
 #if REQUIRE_DEBUG == 1
@@ -465,7 +632,7 @@ static JSValueRef ModuleRequire(JSContextRef ctx, JSObjectRef function, JSObject
     JSObjectRef parent = nullptr;
     if (module!=nullptr) 
     {
-        auto path = std::string(HyperloopJSValueToStringCopy(ctx,arguments[0],exception));
+        auto path = Hyperloop::StringBuffer(ctx,arguments[0],exception).str();
         auto dirname = module->getDirname();
         parent = module->getObject();
         if (dirname==".")
@@ -475,7 +642,23 @@ static JSValueRef ModuleRequire(JSContextRef ctx, JSObjectRef function, JSObject
 #if REQUIRE_DEBUG == 1
     NSLog(@"ModuleRequire path=%s, dirname=%s",path.c_str(),dirname.c_str());
 #endif
-        resolvedPath = requestResolve(parent,path,dirname);
+#if HL_MODULE_STATS
+        auto resolveStart = HyperloopModuleStatsNow();
+#endif
+        // the compiler leaves out requests another unit could answer first
+        const char *outcome = "precomputed";
+        auto precomputed = findPrecomputedRequire(dirname,path);
+        if (precomputed!=nullptr)
+        {
+            resolvedPath.assign(precomputed->path,precomputed->length);
+        }
+        else
+        {
+            resolvedPath = requestResolveCached(parent,path,dirname,&outcome);
+        }
+#if HL_MODULE_STATS
+        HyperloopModuleStatsRecord(HyperloopModuleEventResolve,resolvedPath.c_str(),module->getFilename().c_str(),path.c_str(),outcome,resolveStart);
+#endif
         if (resolvedPath.empty())
         {
             // we pass along so that we can get the right error thrown but 
@@ -496,13 +679,32 @@ static JSValueRef ModuleRequire(JSContextRef ctx, JSObjectRef function, JSObject
     return HyperloopLoadEmbedSource(HyperloopGlobalContext(),parent,resolvedPath.c_str(),exception);
 }
 
+/**
+ * implement the require which is relative to its module. the function carries
+ * its module instead of finding it through this or the global scope
+ */
+static JSValueRef BoundModuleRequire(JSContextRef ctx, JSObjectRef function, JSObjectRef object, size_t argumentCount, const JSValueRef arguments[], JSValueRef* exception)
+{
+    auto module = static_cast<Appcelerator::Module*>(JSObjectGetPrivate(function));
+    return RequireFromModule(ctx,module,argumentCount,arguments,exception);
+}
+
+/**
+ * return the modules require property
+ */
+JSValueRef ModuleRequire (JSContextRef ctx, JSObjectRef object, JSStringRef propertyName, JSValueRef* exception)
+{
+    auto module = JSObjectRefToModule(ctx,object,exception);
+    return module->getRequire();
+}
+
 /**
  * return the modules id property
  */
 JSValueRef ModuleId (JSContextRef ctx, JSObjectRef object, JSStringRef propertyName, JSValueRef* exception)
 {
     auto module = JSObjectRefToModule(ctx,object,exception);
-    return HyperloopMakeString(ctx,module->getId().c_str(),exception);
+    return module->getFilenameValue();
 }
 
 /**
@@ -511,7 +713,7 @@ JSValueRef ModuleId (JSContextRef ctx, JSObjectRef object, JSStringRef propertyN
 JSValueRef ModuleFilename (JSContextRef ctx, JSObjectRef object, JSStringRef propertyName, JSValueRef* exception)
 {
     auto module = JSObjectRefToModule(ctx,object,exception);
-    return HyperloopMakeString(ctx,module->getFilename().c_str(),exception);
+    return module->getFilenameValue();
 }
 
 /**
@@ -543,7 +745,7 @@ JSValueRef ModuleLoaded (JSContextRef ctx, JSObjectRef object, JSStringRef prope
 JSValueRef ModuleDirname (JSContextRef ctx, JSObjectRef object, JSStringRef propertyName, JSValueRef* exception)
 {
     auto module = JSObjectRefToModule(ctx,object,exception);
-    return HyperloopMakeString(ctx,module->getDirname().c_str(),exception);
+    return module->getDirnameValue();
 }
 
 /**
@@ -583,12 +785,8 @@ JSValueRef ModuleGlobal (JSContextRef ctx, JSObjectRef object, JSStringRef prope
     return JSContextGetGlobalObject(globalCtx);
 }
 
-static JSStaticFunction StaticModuleFunctions[] = {
-    { "require", ModuleRequire, kJSPropertyAttributeReadOnly | kJSPropertyAttributeDontEnum | kJSPropertyAttributeDontDelete },
-    { 0, 0, 0 }
-};
-
 static JSStaticValue StaticModuleProperties [] = {
+    { "require", ModuleRequire, 0, kJSPropertyAttributeReadOnly|kJSPropertyAttributeDontEnum|kJSPropertyAttributeDontDelete},
     { "id", ModuleId, 0, kJSPropertyAttributeReadOnly|kJSPropertyAttributeDontEnum},
     { "exports", ModuleExportsGet, ModuleExportsSet, kJSPropertyAttributeDontEnum},
     { "filename", ModuleFilename, 0, kJSPropertyAttributeReadOnly|kJSPropertyAttributeDontEnum},
@@ -612,7 +810,6 @@ static JSClassRef RegisterModuleClass()
         JSClassDefinition def = kJSClassDefinitionEmpty;
         def.className = "Module";
         def.finalize = ModuleFinalizer;
-        def.staticFunctions = StaticModuleFunctions;
         def.staticValues = StaticModuleProperties;
         jsClass = JSClassCreate(&def);
     }
@@ -639,6 +836,63 @@ EXPORTAPI JSObjectRef HyperloopCreateModule(JSGlobalContextRef ctx, JSObjectRef
     return source;
 }
 
+/**
+ * class of the require functions bound to a module
+ */
+static JSClassRef RegisterBoundRequireClass()
+{
+    static JSClassRef jsClass;
+    if (!jsClass)
+    {
+        JSClassDefinition def = kJSClassDefinitionEmpty;
+        def.className = "require";
+        def.callAsFunction = BoundModuleRequire;
+        jsClass = JSClassCreate(&def);
+    }
+    return jsClass;
+}
+
+/**
+ * evaluate source as the body of a function (exports, require, module,
+ * __filename, __dirname) called with the values of module, so loading it
+ * never touches the global object
+ */
+EXPORTAPI JSValueRef HyperloopEvaluateModule(JSGlobalContextRef ctx, JSObjectRef module, JSStringRef source, JSStringRef sourceURL, JSValueRef *exception)
+{
+    auto privateObj = JSObjectRefToModule(ctx,module,exception);
+    const JSStringRef parameterNames[] = {
+        HyperloopWellKnownString(kHyperloopString_exports),
+        HyperloopWellKnownString(kHyperloopString_require),
+        HyperloopWellKnownString(kHyperloopString_module),
+        HyperloopWellKnownString(kHyperloopString___filename),
+        HyperloopWellKnownString(kHyperloopString___dirname)
+    };
+    auto function = JSObjectMakeFunction(ctx,nullptr,5,parameterNames,source,sourceURL,1,exception);
+    if (function==nullptr || privateObj==nullptr)
+    {
+        return JSValueMakeUndefined(ctx);
+    }
+#if HL_MODULE_STATS
+    auto evaluateStart = HyperloopModuleStatsNow();
+#endif
+    auto exports = privateObj->getExports();
+    const JSValueRef arguments[] = {
+        exports,
+        privateObj->getRequire(),
+        module,
+        privateObj->getFilenameValue(),
+        privateObj->getDirnameValue()
+    };
+#if HL_MODULE_STATS
+    auto result = JSObjectCallAsFunction(ctx,function,exports,5,arguments,exception);
+    auto parent = JSObjectRefToModule(ctx,privateObj->getParent(),nullptr,false);
+    HyperloopModuleStatsRecord(HyperloopModuleEventEvaluate,privateObj->getFilename().c_str(),parent ? parent->getFilename().c_str() : nullptr,nullptr,nullptr,evaluateStart);
+    return result;
+#else
+    return JSObjectCallAsFunction(ctx,function,exports,5,arguments,exception);
+#endif
+}
+
 /**
  * called when the module has completed loading
  */
@@ -651,67 +905,270 @@ EXPORTAPI JSObjectRef HyperloopModuleLoaded(JSGlobalContextRef ctx, JSObjectRef
 
 namespace Appcelerator 
 {
-    class TranslationUnit 
+    /**
+     * every registered source path and the translation unit that embeds it.
+     * the first unit to register a path owns it
+     */
+    class TranslationUnitIndex
     {
         public:
-            TranslationUnit(const HyperloopTranslationUnitCallback & callback, const std::set<std::string> & sourcemap) : callback{callback},sourcemap{sourcemap}
+            void add(HyperloopTranslationUnitCallback callback, const HyperloopTranslationUnitEntry *entries, size_t count)
             {
+                callbacks.push_back(callback);
+                paths.add(entries, count, callbacks.size() - 1);
             }
-            inline bool sourceExists(const std::string & name) const 
+            const HyperloopTranslationUnitCallback* find(const char *path, size_t length) const
             {
-                return sourcemap.find(name)!=sourcemap.end();
-            }
-            JSValueRef call(JSGlobalContextRef ctx, const JSObjectRef & parent, const char *path, JSValueRef *exception) const
-            {
-                return callback(ctx,parent,path,exception);
+                size_t unit = 0;
+                auto entry = paths.find(HyperloopPathHash(path, length), [&](const HyperloopTranslationUnitEntry &candidate) {
+                    return candidate.length == length && memcmp(candidate.path, path, length) == 0;
+                }, &unit);
+                return entry != nullptr ? &callbacks[unit] : nullptr;
             }
 
         private:
-            HyperloopTranslationUnitCallback callback;
-            std::set<std::string> sourcemap;
+            StaticEntryIndex<HyperloopTranslationUnitEntry> paths;
+            std::vector<HyperloopTranslationUnitCallback> callbacks;
     };
 }
 
-typedef std::vector<Appcelerator::TranslationUnit> TranslationUnitList;
-static TranslationUnitList translationUnits;
+static Appcelerator::TranslationUnitIndex translationUnits;
+
+/**
+ * called by a translation unit to register its compiled code and the table of its sources
+ */
+EXPORTAPI bool HyperloopRegisterTranslationUnitIndex(HyperloopTranslationUnitCallback callback, const HyperloopTranslationUnitEntry *entries, size_t count)
+{
+    translationUnits.add(callback, entries, count);
+    // a new unit can satisfy requests that failed to resolve before
+    HyperloopResolveCacheClear();
+    return true;
+}
+
+/**
+ * copies of the paths and tables registered through HyperloopRegisterTranslationUnit,
+ * which the index points into for the life of the process
+ */
+static std::deque<std::string> translationUnitPaths;
+static std::deque<std::vector<HyperloopTranslationUnitEntry>> translationUnitEntries;
 
 /**
  * called by a translation unit to register its compiled code and it's pointer to JSValueRef mapping
  */
 EXPORTAPI bool HyperloopRegisterTranslationUnit(HyperloopTranslationUnitCallback callback, size_t count, ...)
 {
-    std::set<std::string> map;
+    translationUnitEntries.emplace_back();
+    auto &entries = translationUnitEntries.back();
+    entries.reserve(count);
     va_list vl;
     va_start(vl,count);
     for (size_t c = 0; c < count; c++) 
     {
-        auto fn = std::string(va_arg(vl,const char*));
-        map.insert(fn);
+        translationUnitPaths.emplace_back(va_arg(vl,const char*));
+        auto &fn = translationUnitPaths.back();
+        entries.push_back(HyperloopTranslationUnitEntry{fn.c_str(), fn.size(), HyperloopPathHash(fn.c_str(), fn.size())});
     }
     va_end(vl);
-    translationUnits.push_back(Appcelerator::TranslationUnit(callback,map));
+    return HyperloopRegisterTranslationUnitIndex(callback, entries.data(), entries.size());
+}
+
+namespace Appcelerator
+{
+    /**
+     * a source pack registered by a translation unit with the tables built
+     * from its index and what was loaded from it so far
+     */
+    struct RegisteredSourcePack
+    {
+        Hyperloop::SourcePack pack;
+        unsigned char key;
+        std::vector<JSValueRef> results;
+        std::vector<HyperloopTranslationUnitEntry> paths;
+        std::vector<HyperloopPrefetchEntry> graph;
+        std::vector<size_t> dependencies;
+    };
+}
+
+static std::deque<Appcelerator::RegisteredSourcePack> sourcePacks;
+static std::string sourcePackDirectory;
+
+/**
+ * set the directory relative source pack filenames are found in
+ */
+EXPORTAPI void HyperloopSetSourcePackDirectory(const char *directory)
+{
+    sourcePackDirectory = directory ? directory : "";
+}
+
+/**
+ * called by a translation unit to map the source pack holding its sources. the
+ * packed paths are registered with callback and the pack's dependency graph
+ * with the prefetcher
+ */
+EXPORTAPI bool HyperloopRegisterSourcePack(HyperloopTranslationUnitCallback callback, const char *filename, unsigned char key)
+{
+    std::string filepath(filename);
+    if (!sourcePackDirectory.empty() && filename[0]!='/')
+    {
+        filepath = sourcePackDirectory + "/" + filepath;
+    }
+    sourcePacks.emplace_back();
+    auto &registered = sourcePacks.back();
+    auto &pack = registered.pack;
+    if (!pack.open(filepath.c_str()))
+    {
+        sourcePacks.pop_back();
+        return false;
+    }
+    registered.key = key;
+    registered.results.resize(pack.size(),nullptr);
+    // the graph points into dependencies so it must not grow after this
+    size_t total = 0;
+    for (size_t c = 0; c < pack.size(); c++)
+    {
+        total += pack.entry(c).dependencyCount;
+    }
+    registered.dependencies.reserve(total);
+    for (size_t c = 0; c < pack.size(); c++)
+    {
+        auto &entry = pack.entry(c);
+        auto path = pack.string(entry.path);
+        // UTF-16 sources need no decoding so they are not prefetched
+        auto source = entry.sourceLength ? pack.source(entry) : nullptr;
+        auto encoded = entry.flags & HL_SOURCE_PACK_UTF16 ? nullptr : source;
+        auto deps = pack.dependencies(entry);
+        auto first = registered.dependencies.size();
+        registered.dependencies.insert(registered.dependencies.end(),deps,deps+entry.dependencyCount);
+        registered.graph.push_back(HyperloopPrefetchEntry{path,encoded,encoded ? entry.sourceLength : 0,registered.dependencies.data()+first,entry.dependencyCount});
+        if (source)
+        {
+            registered.paths.push_back(HyperloopTranslationUnitEntry{path,entry.pathLength,entry.hash});
+        }
+    }
+    HyperloopRegisterTranslationUnitIndex(callback,registered.paths.data(),registered.paths.size());
+    HyperloopRegisterPrefetchGraph(registered.graph.data(),registered.graph.size(),key);
     return true;
 }
 
-static TranslationUnitList::const_iterator findTranslationUnit (const char *filepath) 
+/**
+ * evaluate source in the global scope with module, exports, __filename,
+ * __dirname and require set from module, restoring the previous values after,
+ * the way a translation unit evaluates its embedded sources without the wrapper
+ */
+static void EvaluateModuleInGlobalScope(JSGlobalContextRef ctx, JSObjectRef module, JSStringRef source, JSStringRef sourceURL, JSValueRef *exception)
 {
-    std::string path(filepath);
-    return find_if(translationUnits.begin(), translationUnits.end(), [&path] (TranslationUnitList::const_reference tu)
+    static const HyperloopStringName names[] = {
+        kHyperloopString_module,
+        kHyperloopString_exports,
+        kHyperloopString___filename,
+        kHyperloopString___dirname,
+        kHyperloopString_require
+    };
+    static const size_t count = sizeof(names) / sizeof(names[0]);
+    auto object = JSContextGetGlobalObject(ctx);
+    JSValueRef saved[count];
+    for (size_t c = 0; c < count; c++)
     {
-        if (tu.sourceExists(path))
+        auto name = HyperloopWellKnownString(names[c]);
+        saved[c] = JSObjectGetProperty(ctx,object,name,nullptr);
+        auto value = names[c]==kHyperloopString_module ? module : JSObjectGetProperty(ctx,module,name,nullptr);
+        JSObjectSetProperty(ctx,object,name,value,0,nullptr);
+    }
+    JSEvaluateScript(ctx,source,nullptr,sourceURL,1,exception);
+    for (size_t c = 0; c < count; c++)
+    {
+        JSObjectSetProperty(ctx,object,HyperloopWellKnownString(names[c]),saved[c],0,nullptr);
+    }
+}
+
+/**
+ * evaluate a source from a pack the way a translation unit evaluates its
+ * embedded sources, returning nullptr when it threw
+ */
+static JSValueRef LoadSourcePackEntry(JSGlobalContextRef ctx, const JSObjectRef & parent, const Appcelerator::RegisteredSourcePack &registered, const Hyperloop::SourcePackEntry &entry, JSValueRef *exception)
+{
+    auto &pack = registered.pack;
+    // the pack stays mapped so UTF-16 sources can be used in place
+    auto source = entry.flags & HL_SOURCE_PACK_UTF16 ?
+        HyperloopCreateEmbedString(reinterpret_cast<const JSChar *>(pack.source(entry)),entry.sourceLength / sizeof(JSChar)) :
+        HyperloopTakeEmbedString(pack.source(entry),entry.sourceLength,registered.key);
+    if (entry.flags & HL_SOURCE_PACK_JSON)
+    {
+        auto result = JSValueMakeFromJSONString(ctx,source);
+        JSStringRelease(source);
+        if (result!=nullptr)
         {
-            return true;
+            JSValueProtect(ctx,result);
         }
-        return false;
-    });
+        return result;
+    }
+    auto filename = pack.string(entry.filename);
+    auto module = HyperloopCreateModule(ctx,parent,filename,pack.string(entry.dirname),exception);
+    auto sourceURL = JSStringCreateWithUTF8CString(filename);
+    if (entry.flags & HL_SOURCE_PACK_WRAPPED)
+    {
+        HyperloopEvaluateModule(ctx,module,source,sourceURL,exception);
+    }
+    else
+    {
+        EvaluateModuleInGlobalScope(ctx,module,source,sourceURL,exception);
+    }
+    JSStringRelease(sourceURL);
+    JSStringRelease(source);
+    if (*exception!=nullptr && !JSValueIsNull(ctx,*exception))
+    {
+        return nullptr;
+    }
+    return HyperloopModuleLoaded(ctx,module);
+}
+
+/**
+ * load path from the registered source packs. returns nullptr when no pack has
+ * it, so the caller can report the module as missing
+ */
+EXPORTAPI JSValueRef HyperloopLoadSourcePack(JSGlobalContextRef ctx, const JSObjectRef & parent, const char *path, JSValueRef *exception)
+{
+    auto length = strlen(path);
+    auto hash = HyperloopPathHash(path,length);
+    for (auto &registered : sourcePacks)
+    {
+        auto index = registered.pack.find(path,length,hash);
+        if (index==registered.pack.size() || registered.pack.entry(index).sourceLength==0)
+        {
+            continue;
+        }
+        auto &result = registered.results[index];
+        if (result==nullptr)
+        {
+            JSValueRef ignored = nullptr;
+            result = LoadSourcePackEntry(ctx,parent,registered,registered.pack.entry(index),exception ? exception : &ignored);
+        }
+        return result ? result : JSValueMakeUndefined(ctx);
+    }
+    return nullptr;
+}
+
+static const HyperloopTranslationUnitCallback* findTranslationUnit (const char *filepath) 
+{
+    return translationUnits.find(filepath, strlen(filepath));
 }
 
 static JSValueRef HyperloopLoadEmbedSource(JSGlobalContextRef ctx, const JSObjectRef & object, const char *path, JSValueRef *exception)
 {
     auto found = findTranslationUnit(path);
-    if (found!=translationUnits.end())
+    if (found!=nullptr)
     {
-        return found->call(ctx,object,path,exception);
+#if HL_MODULE_STATS
+        auto parentModule = JSObjectRefToModule(ctx,object,nullptr,false);
+        auto loadStart = HyperloopModuleStatsNow();
+        HyperloopModuleStatsPush(path);
+        auto result = (*found)(ctx,object,path,exception);
+        HyperloopModuleStatsPop();
+        HyperloopModuleStatsRecord(HyperloopModuleEventLoad,path,parentModule ? parentModule->getFilename().c_str() : nullptr,nullptr,nullptr,loadStart);
+        return result;
+#else
+        return (*found)(ctx,object,path,exception);
+#endif
     }
 
     auto msg = std::string("Cannot find module '");
@@ -719,17 +1176,14 @@ static JSValueRef HyperloopLoadEmbedSource(JSGlobalContextRef ctx, const JSObjec
     msg+=std::string("'");
     auto result = HyperloopMakeException(ctx,msg.c_str());
     auto msgStr = HyperloopMakeString(ctx,"MODULE_NOT_FOUND",0);
-    auto code = JSStringCreateWithUTF8CString("code");
     auto obj = JSValueToObject(ctx,result,0);
-    JSObjectSetProperty(ctx, obj, code, msgStr, 0, 0);
-    JSStringRelease(code);
+    JSObjectSetProperty(ctx, obj, HyperloopWellKnownString(kHyperloopString_code), msgStr, 0, 0);
     *exception = result;
 
     return JSValueMakeUndefined(ctx);
 }
 
-static bool HyperloopLoadEmbedSourceExists (const char *filepath)
+static bool HyperloopLoadEmbedSourceExists (const char *filepath, size_t length)
 {
-    auto found = findTranslationUnit(filepath);
-    return found!=translationUnits.end();
+    return translationUnits.find(filepath, length)!=nullptr;
 }
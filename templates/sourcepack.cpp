@@ -0,0 +1,188 @@
+/**
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License
+ * Please see the LICENSE included with this distribution for details.
+ *
+ * This code and related technologies are covered by patents
+ * or patents pending by Appcelerator, Inc.
+ */
+#ifndef HL_TEST
+#include <hyperloop.h>
+#else
+#include <sourcepack.h>
+#endif
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static const char SourcePackMagic[4] = { 'H', 'L', 'P', 'K' };
+static const uint32_t SourcePackVersion = 1;
+static const size_t SourcePackHeaderSize = 16;
+
+Hyperloop::SourcePack::SourcePack() : data(nullptr), length(0), entries(nullptr), count(0)
+#ifdef _WIN32
+    , file(INVALID_HANDLE_VALUE), mapping(nullptr)
+#endif
+{
+}
+
+Hyperloop::SourcePack::~SourcePack()
+{
+    close();
+}
+
+bool Hyperloop::SourcePack::open(const char *filename)
+{
+    close();
+#ifdef _WIN32
+    file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart < SourcePackHeaderSize || (mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr)) == nullptr)
+    {
+        close();
+        return false;
+    }
+    data = static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    length = static_cast<size_t>(size.QuadPart);
+#else
+    auto fd = ::open(filename, O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < SourcePackHeaderSize)
+    {
+        ::close(fd);
+        return false;
+    }
+    // the mapping keeps the file alive, the descriptor isn't needed anymore
+    auto mapped = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED)
+    {
+        return false;
+    }
+    data = static_cast<const char *>(mapped);
+    length = static_cast<size_t>(st.st_size);
+#endif
+    if (data == nullptr || !validate())
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void Hyperloop::SourcePack::close()
+{
+#ifdef _WIN32
+    if (data != nullptr)
+    {
+        UnmapViewOfFile(data);
+    }
+    if (mapping != nullptr)
+    {
+        CloseHandle(mapping);
+        mapping = nullptr;
+    }
+    if (file != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(file);
+        file = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (data != nullptr)
+    {
+        munmap(const_cast<char *>(data), length);
+    }
+#endif
+    data = nullptr;
+    length = 0;
+    entries = nullptr;
+    count = 0;
+}
+
+/**
+ * check every offset once when the pack is mapped so lookups and loads can
+ * trust them
+ */
+bool Hyperloop::SourcePack::validate()
+{
+    uint32_t header[3];
+    memcpy(header, data + 4, sizeof(header));
+    if (memcmp(data, SourcePackMagic, sizeof(SourcePackMagic)) != 0 || header[0] != SourcePackVersion)
+    {
+        return false;
+    }
+    auto total = static_cast<size_t>(header[1]);
+    if (total > (length - SourcePackHeaderSize) / sizeof(SourcePackEntry))
+    {
+        return false;
+    }
+    auto table = reinterpret_cast<const SourcePackEntry *>(data + SourcePackHeaderSize);
+    auto terminated = [this](uint32_t offset) {
+        return offset < length && memchr(data + offset, '\0', length - offset) != nullptr;
+    };
+    for (size_t c = 0; c < total; c++)
+    {
+        auto &e = table[c];
+        if (!terminated(e.path) || e.pathLength != strlen(data + e.path) ||
+            !terminated(e.filename) || !terminated(e.dirname) ||
+            e.source > length || e.sourceLength > length - e.source ||
+            ((e.flags & HL_SOURCE_PACK_UTF16) && (e.source % sizeof(uint16_t) != 0 || e.sourceLength % sizeof(uint16_t) != 0)) ||
+            e.dependencies % sizeof(uint32_t) != 0 || e.dependencies > length ||
+            e.dependencyCount > (length - e.dependencies) / sizeof(uint32_t) ||
+            (c > 0 && table[c - 1].hash > e.hash))
+        {
+            return false;
+        }
+        auto deps = reinterpret_cast<const uint32_t *>(data + e.dependencies);
+        for (size_t d = 0; d < e.dependencyCount; d++)
+        {
+            if (deps[d] >= total)
+            {
+                return false;
+            }
+        }
+    }
+    entries = table;
+    count = total;
+    return true;
+}
+
+size_t Hyperloop::SourcePack::find(const char *path, size_t len, uint32_t hash) const
+{
+    size_t low = 0, high = count;
+    while (low < high)
+    {
+        auto middle = low + (high - low) / 2;
+        if (entries[middle].hash < hash)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    for (; low < count && entries[low].hash == hash; low++)
+    {
+        auto &e = entries[low];
+        if (e.pathLength == len && memcmp(data + e.path, path, len) == 0)
+        {
+            return low;
+        }
+    }
+    return count;
+}
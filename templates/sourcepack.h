@@ -0,0 +1,99 @@
+/**
+ * Copyright (c) 2014 by Appcelerator, Inc. All Rights Reserved.
+ * Licensed under the terms of the Apache Public License
+ * Please see the LICENSE included with this distribution for details.
+ *
+ * This code and related technologies are covered by patents
+ * or patents pending by Appcelerator, Inc.
+ */
+#ifndef __HYPERLOOP_SOURCEPACK_HEADER__
+#define __HYPERLOOP_SOURCEPACK_HEADER__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * SourcePackEntry flag set when the source is JSON
+ */
+#define HL_SOURCE_PACK_JSON 0x01
+
+/**
+ * SourcePackEntry flag set when the source is UTF-16LE code units, aligned
+ * for use in place and neither obfuscated nor compressed
+ */
+#define HL_SOURCE_PACK_UTF16 0x02
+
+/**
+ * SourcePackEntry flag set when the module is evaluated in a CommonJS function
+ * wrapper instead of the global scope
+ */
+#define HL_SOURCE_PACK_WRAPPED 0x04
+
+namespace Hyperloop
+{
+    /**
+     * a source pack is a file of embedded sources that is memory mapped instead
+     * of compiled into the app. it starts with "HLPK", a version, the entry
+     * count and a reserved word, followed by the entries sorted by path hash and
+     * then path. strings are NUL terminated. numbers are little endian and
+     * offsets are from the start of the file
+     */
+    struct SourcePackEntry
+    {
+        uint32_t hash;              // HyperloopPathHash of path
+        uint32_t path;
+        uint32_t pathLength;
+        uint32_t filename;          // filename and dirname of the module
+        uint32_t dirname;
+        uint32_t source;            // the encoded source, as embedded in a translation unit
+        uint32_t sourceLength;      // 0 for a module compiled into the app
+        uint32_t flags;
+        uint32_t dependencies;      // indexes of the entries this one requires
+        uint32_t dependencyCount;
+    };
+
+    class SourcePack
+    {
+    public:
+        SourcePack();
+        ~SourcePack();
+
+        /**
+         * map filename and check its index, false when it is missing or malformed
+         */
+        bool open(const char *filename);
+
+        size_t size() const { return count; }
+        const SourcePackEntry& entry(size_t index) const { return entries[index]; }
+        const char* string(uint32_t offset) const { return data + offset; }
+        const char* source(const SourcePackEntry &entry) const { return data + entry.source; }
+        const uint32_t* dependencies(const SourcePackEntry &entry) const
+        {
+            return reinterpret_cast<const uint32_t *>(data + entry.dependencies);
+        }
+
+        /**
+         * return the index of the entry for path with HyperloopPathHash hash, or
+         * size() when there is none
+         */
+        size_t find(const char *path, size_t length, uint32_t hash) const;
+
+    private:
+        SourcePack(const SourcePack&);
+        SourcePack& operator=(const SourcePack&);
+
+        bool validate();
+        void close();
+
+        const char *data;
+        size_t length;
+        const SourcePackEntry *entries;
+        size_t count;
+#ifdef _WIN32
+        void *file;
+        void *mapping;
+#endif
+    };
+}
+
+#endif